@@ -0,0 +1,52 @@
+import os
+
+# Generates verilator/instruction_names.h, the name of each of the 0x300
+# extended opcodes for the retire log decoder. Names are taken from the
+# comments in rom/microinstructions.txt: the heading comment above a group
+# of opcodes (e.g. "// 8-bit ADD"), or a comment on the opcode line itself
+# (e.g. "#CFB8 // PUSH ALL"). @note comments and commented out
+# microinstructions are skipped.
+
+if __name__ == '__main__':
+
+    root = os.path.abspath(os.path.join(os.path.dirname(__file__), '../'))
+    lines = open(os.path.join(root, 'rom/microinstructions.txt'), 'r').readlines()
+
+    names = [None] * 0x300
+    group = None
+    for line in lines:
+        line = line.strip()
+
+        if line.startswith('//'):
+            comment = line[2:].strip()
+            if not comment.startswith('@') and not comment.startswith('TYPE_'):
+                group = comment
+            continue
+
+        if len(line) == 0 or line[0] != '#' or line[1:].startswith('default'):
+            continue
+
+        name = group
+        comment_start = line.find('//')
+        if comment_start > -1:
+            comment = line[comment_start+2:].strip()
+            if not comment.startswith('@'):
+                name = comment
+            line = line[:comment_start].strip()
+
+        opcode = int(line[1:], base=16)
+        if opcode >= 0xCF00:
+            opcode = 0x200 | opcode & 0xFF
+        elif opcode >= 0xCE00:
+            opcode = 0x100 | opcode & 0xFF
+
+        names[opcode] = name
+
+    with open(os.path.join(root, 'verilator/instruction_names.h'), 'w') as fp:
+        fp.write('// Generated by scripts/make_instruction_names.py, do not edit.\n')
+        fp.write('const char* instruction_names[%d] = {\n' % 0x300)
+        for i, name in enumerate(names):
+            fp.write('    %s, // 0x%03X\n' % ('"%s"' % name if name else 'nullptr', i))
+        fp.write('};\n')
+
+    print('%d/768 opcodes named.' % len([x for x in names if x]))
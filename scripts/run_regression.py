@@ -0,0 +1,150 @@
+import argparse
+import concurrent.futures
+import json
+import os
+import subprocess
+import sys
+
+# Runs the roms of a regression manifest through minx_bench in parallel and
+# compares the hashes of selected frames against the recorded ones.
+#
+# Manifest format (paths are relative to the simulation directory, which is
+# where minx_bench finds data/bios.min):
+#
+#   {
+#       "roms": [
+#           {
+#               "rom": "data/party_j.min",
+#               "frames": 600,
+#               "inputs": [[300, "0x01"], [304, "0x00"]],
+#               "check_frames": [300, 600],
+#               "hashes": {"300": "0x...", "600": "0x..."}
+#           }
+#       ]
+#   }
+#
+# "inputs" are [frame, keys_active] pairs, applied once the frame is reached.
+# The machines start at the wall clock time (seconds since the epoch, UTC)
+# given by an optional top level "start_time", passed to minx_bench -T;
+# without it minx_bench's fixed default is used. Either way the eeprom
+# clock the bios sets is the same in every run, so roms reading it hash
+# the same.
+# Run with --update to record the hashes of the check frames of the roms
+# that have none yet; --accept also replaces the hashes of failing roms,
+# making their new output the baseline. Roms found by --sweep are run but
+# never added to the manifest.
+#
+# Usage: python3 scripts/run_regression.py verilator/regression.json
+
+def run_rom(bench, sim_dir, entry, fast_forward, boot_cache, start_time):
+    command = [bench, '-f', str(entry['frames'])]
+    if start_time is not None:
+        command += ['-T', str(start_time)]
+    if fast_forward:
+        command.append('-F')
+    if boot_cache:
+        command += ['-C', boot_cache]
+    for frame, keys in entry.get('inputs', []):
+        command += ['-k', '%d:%s' % (frame, keys)]
+    for frame in entry.get('check_frames', []):
+        command += ['-H', str(frame)]
+    command.append(entry['rom'])
+
+    result = {'rom': entry['rom'], 'hashes': {}, 'mhz': 0.0, 'error': None, 'missing': False}
+    if not os.path.isfile(os.path.join(sim_dir, entry['rom'])):
+        result['missing'] = True
+        return result
+
+    try:
+        output = subprocess.run(command, cwd=sim_dir, capture_output=True, text=True)
+    except OSError as e:
+        result['error'] = str(e)
+        return result
+
+    for line in output.stdout.splitlines():
+        fields = line.split()
+        if len(fields) == 4 and fields[0] == 'hash':
+            result['hashes'][fields[2]] = fields[3]
+        elif len(fields) >= 5 and fields[0] == entry['rom']:
+            result['mhz'] = float(fields[4])
+
+    if output.returncode != 0 or result['mhz'] == 0.0:
+        result['error'] = output.stderr.strip().splitlines()[-1] if output.stderr.strip() else 'no result'
+
+    return result
+
+def check_result(entry, result):
+    if result['missing']:
+        return 'SKIP', 'rom not found'
+
+    if result['error']:
+        return 'ERROR', result['error']
+
+    expected = entry.get('hashes', {})
+    if len(expected) == 0:
+        return 'NEW', 'no hashes recorded'
+
+    mismatches = []
+    for frame, expected_hash in sorted(expected.items(), key=lambda x: int(x[0])):
+        actual_hash = result['hashes'].get(frame)
+        if actual_hash != expected_hash:
+            mismatches.append('frame %s: %s != %s' % (frame, actual_hash, expected_hash))
+
+    if len(mismatches) > 0:
+        return 'FAIL', ', '.join(mismatches)
+    return 'PASS', ''
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(description='Run the rom regression manifest.')
+    parser.add_argument('manifest')
+    parser.add_argument('--sim-dir', default='verilator', help='directory minx_bench runs in')
+    parser.add_argument('--bench', default='obj_bench/minx_bench', help='minx_bench binary, relative to the sim directory')
+    parser.add_argument('-j', '--jobs', type=int, default=os.cpu_count())
+    parser.add_argument('-F', '--fast-forward', action='store_true', help='run with HALT fast-forward')
+    parser.add_argument('--boot-cache', metavar='DIR', help='start the roms from the end of the bios boot, cached in DIR (relative to the sim directory); needs minx_bench built with SAVESTATE=1')
+    parser.add_argument('--update', action='store_true', help='record the hashes of the check frames of roms that have none')
+    parser.add_argument('--accept', action='store_true', help='with --update, also replace the hashes of failing roms')
+    parser.add_argument('--sweep', metavar='DIR', help='also run every .min in DIR (relative to the sim directory) not in the manifest')
+    parser.add_argument('--sweep-frames', type=int, default=600)
+    args = parser.parse_args()
+
+    manifest = json.load(open(args.manifest))
+    entries = list(manifest['roms'])
+
+    # Sweep entries are kept out of manifest['roms'] so --update doesn't
+    # write them back.
+    if args.sweep:
+        listed = set(entry['rom'] for entry in entries)
+        for filename in sorted(os.listdir(os.path.join(args.sim_dir, args.sweep))):
+            rom = os.path.join(args.sweep, filename)
+            if filename.endswith('.min') and filename != 'bios.min' and rom not in listed:
+                entries.append({'rom': rom, 'frames': args.sweep_frames, 'check_frames': [args.sweep_frames], 'hashes': {}})
+
+    bench = os.path.abspath(os.path.join(args.sim_dir, args.bench))
+    if not os.path.isfile(bench):
+        print('Benchmark binary %s not found, build it with verilator/build_bench.sh.' % bench)
+        sys.exit(1)
+
+    # Each rom runs in its own minx_bench process, the threads only wait on
+    # them.
+    with concurrent.futures.ThreadPoolExecutor(max_workers=args.jobs) as executor:
+        results = list(executor.map(lambda entry: run_rom(bench, args.sim_dir, entry, args.fast_forward, args.boot_cache, manifest.get('start_time')), entries))
+
+    num_failed = 0
+    for entry, result in zip(entries, results):
+        status, message = check_result(entry, result)
+        if status in ('FAIL', 'ERROR'):
+            num_failed += 1
+        print('%-6s %-50s %8.3f MHz  %s' % (status, entry['rom'], result['mhz'], message))
+
+        if args.update and (status == 'NEW' or (status == 'FAIL' and args.accept)):
+            entry['hashes'] = result['hashes']
+
+    print('%d of %d roms failed.' % (num_failed, len(entries)))
+
+    if args.update:
+        with open(args.manifest, 'w') as fp:
+            json.dump(manifest, fp, indent=4)
+            fp.write('\n')
+
+    sys.exit(1 if num_failed > 0 else 0)
@@ -0,0 +1,47 @@
+#!/bin/bash
+# Builds minx_bench with 1, 2, 4 and 8 verilator threads, runs the same
+# roms on each build and prints the speedup over the single threaded one.
+#
+# Usage: ./bench_threads.sh [minx_bench options] rom.min [rom.min ...]
+if [ $# -eq 0 ]
+then
+    echo "Usage: $0 [minx_bench options] rom.min [rom.min ...]"
+    exit 1
+fi
+
+THREAD_COUNTS="1 2 4 8"
+
+for threads in $THREAD_COUNTS
+do
+    echo "Building with $threads thread(s)."
+    ./build_bench.sh $threads > build_bench_t$threads.log 2>&1 || { echo "Build failed, see build_bench_t$threads.log."; exit 1; }
+done
+
+printf "%8s %9s %9s %8s\n" "threads" "wall_s" "emu_MHz" "speedup"
+
+BASE_MHZ=""
+for threads in $THREAD_COUNTS
+do
+    MDIR=obj_bench
+    if [ "$threads" -gt 1 ]
+    then
+        MDIR=obj_bench_t$threads
+    fi
+
+    # The total line is: total frames cycles wall_s emu_MHz ...
+    TOTAL=$(./$MDIR/minx_bench "$@" | grep "^total")
+    if [ -z "$TOTAL" ]
+    then
+        echo "No results for $threads thread(s)."
+        exit 1
+    fi
+
+    WALL=$(echo "$TOTAL" | awk '{ print $4 }')
+    MHZ=$(echo "$TOTAL" | awk '{ print $5 }')
+    if [ -z "$BASE_MHZ" ]
+    then
+        BASE_MHZ=$MHZ
+    fi
+
+    awk -v t=$threads -v w=$WALL -v m=$MHZ -v b=$BASE_MHZ 'BEGIN { printf "%8d %9.3f %9.3f %7.2fx\n", t, w, m, m / b }'
+done
@@ -1,4 +1,56 @@
 #!/bin/bash
 python3 ../scripts/generate_microrom.py
-$VERILATOR_ROOT/bin/verilator -O3 -Wno-fatal -trace --top-module $1 -I../rtl --cc ../rtl/$1.sv --exe $1_sim.cpp
+
+# TRACE selects the waveform format of the minx harnesses: vcd (default),
+# fst or both. FST needs zlib and is much smaller and faster to write; the
+# harness picks the format from the extension of the dump file. The other
+# modules' harnesses only write VCD.
+TRACE_FLAGS="--trace"
+if [ "$1" == "minx" ]
+then
+    case "$TRACE" in
+        fst)  TRACE_FLAGS="--trace-fst" ;;
+        both) TRACE_FLAGS="--trace --trace-fst" ;;
+    esac
+
+    # TRACE_THREADS=2 moves FST encoding off the simulation thread. VCD
+    # dumps are always written by a thread of their own, see
+    # trace_writer.h.
+    if [ -n "$TRACE_THREADS" ]
+    then
+        TRACE_FLAGS="$TRACE_FLAGS --trace-threads $TRACE_THREADS"
+    fi
+elif [ -n "$TRACE" ] && [ "$TRACE" != "vcd" ]
+then
+    echo "TRACE=$TRACE is only supported for minx, building $1 with VCD tracing."
+fi
+
+# The minx harnesses peek at internal signals listed in minx_public.vlt.
+VLT=""
+if [ "$1" == "minx" ]
+then
+    VLT="minx_public.vlt"
+fi
+
+# The model is built with --savable for save states (sim_state.h), set
+# SAVESTATE=0 to leave them out.
+SAVE_FLAGS=""
+if [ "$SAVESTATE" != "0" ]
+then
+    SAVE_FLAGS="--savable -CFLAGS -DSIM_SAVESTATE=1"
+fi
+
+# Boot cache states (sim_state.h) are keyed by a hash of the rtl, the
+# microcode and the verilator flags.
+BUILD_ID=$( (cat ../rtl/*.sv ../rtl/*.v ../rtl/*.vhd rom/*.mem *.mem 2>/dev/null; echo "$TRACE_FLAGS $SAVE_FLAGS") | cksum | cut -d' ' -f1)
+SAVE_FLAGS="$SAVE_FLAGS -CFLAGS -DSIM_BUILD_ID=${BUILD_ID}ULL"
+
+# LZ4=1 lets the retire log (retire_log.h) write .lz4 files.
+LZ4_FLAGS=""
+if [ "$LZ4" == "1" ]
+then
+    LZ4_FLAGS="-CFLAGS -DSIM_HAVE_LZ4=1 -LDFLAGS -llz4"
+fi
+
+$VERILATOR_ROOT/bin/verilator -O3 -Wno-fatal $TRACE_FLAGS --top-module $1 $SAVE_FLAGS $LZ4_FLAGS -I../rtl --cc $VLT ../rtl/$1.sv --exe $1_sim.cpp
 #verilator -O3 -Wno-fatal -trace --top-module 's1c88' -I.. --cc ../s1c88.sv --exe s1c88_sim.cpp
@@ -0,0 +1,45 @@
+#!/bin/bash
+# Builds the headless benchmark (minx_bench.cpp) without tracing, into its
+# own object directory so it doesn't clobber the traced builds. Only the
+# signals listed in minx_public.vlt are kept public.
+#
+# Usage: ./build_bench.sh [threads]
+#
+# With threads > 1 the model is built with verilator --threads into
+# obj_bench_t<threads>/, otherwise single threaded into obj_bench/.
+THREADS=${1:-1}
+MDIR=obj_bench
+THREAD_FLAGS=""
+if [ "$THREADS" -gt 1 ]
+then
+    MDIR=obj_bench_t$THREADS
+    THREAD_FLAGS="--threads $THREADS"
+fi
+
+python3 ../scripts/generate_microrom.py
+mkdir -p rom/
+mv *.mem rom/
+
+# SAVESTATE=1 builds the model with --savable for save states, see
+# sim_state.h.
+SAVE_FLAGS=""
+if [ "$SAVESTATE" == "1" ]
+then
+    SAVE_FLAGS="--savable -CFLAGS -DSIM_SAVESTATE=1"
+fi
+
+# Boot cache states (sim_state.h) are keyed by a hash of the rtl, the
+# microcode and the verilator flags.
+BUILD_ID=$( (cat ../rtl/*.sv ../rtl/*.v ../rtl/*.vhd rom/*.mem *.mem 2>/dev/null; echo "$THREAD_FLAGS $SAVE_FLAGS") | cksum | cut -d' ' -f1)
+SAVE_FLAGS="$SAVE_FLAGS -CFLAGS -DSIM_BUILD_ID=${BUILD_ID}ULL"
+
+# LZ4=1 lets the retire log (retire_log.h) write .lz4 files.
+LZ4_FLAGS=""
+if [ "$LZ4" == "1" ]
+then
+    LZ4_FLAGS="-CFLAGS -DSIM_HAVE_LZ4=1 -LDFLAGS -llz4"
+fi
+
+$VERILATOR_ROOT/bin/verilator -O3 -Wno-fatal $THREAD_FLAGS --top-module minx $SAVE_FLAGS $LZ4_FLAGS -I../rtl --cc minx_public.vlt ../rtl/minx.sv --exe minx_bench.cpp --Mdir $MDIR -o minx_bench
+
+make -C $MDIR/ -f Vminx.mk
@@ -0,0 +1,24 @@
+#!/bin/bash
+# Builds the input explorer (minx_explore.cpp) without tracing into
+# obj_explore/. The model is single threaded since branches are forked, see
+# sim_fork.h.
+python3 ../scripts/generate_microrom.py
+mkdir -p rom/
+mv *.mem rom/
+
+# SAVESTATE=1 builds the model with --savable, for -load-state and the boot
+# cache, see sim_state.h.
+SAVE_FLAGS=""
+if [ "$SAVESTATE" == "1" ]
+then
+    SAVE_FLAGS="--savable -CFLAGS -DSIM_SAVESTATE=1"
+fi
+
+# Boot cache states (sim_state.h) are keyed by a hash of the rtl, the
+# microcode and the verilator flags.
+BUILD_ID=$( (cat ../rtl/*.sv ../rtl/*.v ../rtl/*.vhd rom/*.mem *.mem 2>/dev/null; echo "$SAVE_FLAGS") | cksum | cut -d' ' -f1)
+SAVE_FLAGS="$SAVE_FLAGS -CFLAGS -DSIM_BUILD_ID=${BUILD_ID}ULL"
+
+$VERILATOR_ROOT/bin/verilator -O3 -Wno-fatal --top-module minx $SAVE_FLAGS -I../rtl --cc minx_public.vlt ../rtl/minx.sv --exe minx_explore.cpp --Mdir obj_explore -o minx_explore
+
+make -C obj_explore/ -f Vminx.mk
@@ -3,12 +3,41 @@ python3 ../scripts/generate_microrom.py
 mkdir -p rom/
 mv *.mem rom/
 
+# TRACE selects the waveform format: vcd (default), fst or both. FST needs
+# zlib and is much smaller and faster to write; the harness picks the format
+# from the extension of the dump file.
+case "$TRACE" in
+    fst)  TRACE_FLAGS="--trace-fst" ;;
+    both) TRACE_FLAGS="--trace --trace-fst" ;;
+    *)    TRACE_FLAGS="--trace" ;;
+esac
+
+# TRACE_THREADS=2 moves FST encoding off the simulation thread. VCD dumps
+# are always written by a thread of their own, see trace_writer.h.
+if [ -n "$TRACE_THREADS" ]
+then
+    TRACE_FLAGS="$TRACE_FLAGS --trace-threads $TRACE_THREADS"
+fi
+
+# The model is built with --savable for save states (sim_state.h), set
+# SAVESTATE=0 to leave them out.
+SAVE_FLAGS=""
+if [ "$SAVESTATE" != "0" ]
+then
+    SAVE_FLAGS="--savable -CFLAGS -DSIM_SAVESTATE=1"
+fi
+
+# Boot cache states (sim_state.h) are keyed by a hash of the rtl, the
+# microcode and the verilator flags.
+BUILD_ID=$( (cat ../rtl/*.sv ../rtl/*.v ../rtl/*.vhd rom/*.mem *.mem 2>/dev/null; echo "$TRACE_FLAGS $SAVE_FLAGS") | cksum | cut -d' ' -f1)
+SAVE_FLAGS="$SAVE_FLAGS -CFLAGS -DSIM_BUILD_ID=${BUILD_ID}ULL"
+
 if [ "$(uname)" == "Darwin" ]
 then
-    $VERILATOR_ROOT/bin/verilator -O3 -Wno-fatal -trace --top-module minx -I../rtl --cc ../rtl/minx.sv --exe minx_sdl2_sim.cpp -LDFLAGS "-framework OpenGL `sdl2-config  --libs` -lglew"
+    $VERILATOR_ROOT/bin/verilator -O3 -Wno-fatal $TRACE_FLAGS $SAVE_FLAGS --top-module minx -I../rtl --cc minx_public.vlt ../rtl/minx.sv --exe minx_sdl2_sim.cpp -LDFLAGS "-framework OpenGL `sdl2-config  --libs` -lglew"
 elif [ "$(expr substr $(uname -s) 1 5)" == "Linux" ]
 then
-    $VERILATOR_ROOT/bin/verilator -O3 -Wno-fatal -trace --top-module minx -I../rtl --cc ../rtl/minx.sv --exe minx_sdl2_sim.cpp -LDFLAGS "-lGL `sdl2-config  --libs` -lGLEW"
+    $VERILATOR_ROOT/bin/verilator -O3 -Wno-fatal $TRACE_FLAGS $SAVE_FLAGS --top-module minx -I../rtl --cc minx_public.vlt ../rtl/minx.sv --exe minx_sdl2_sim.cpp -LDFLAGS "-lGL `sdl2-config  --libs` -lGLEW"
 fi
 
 make -C obj_dir/ -f Vminx.mk
@@ -0,0 +1,22 @@
+#!/bin/bash
+# Builds the offline tools that read the logs written by the harnesses. They
+# don't depend on the model, so verilator isn't needed.
+#
+# Usage: ./build_tools.sh
+#
+# Set LZ4=1 to read LZ4 compressed logs; the harnesses have to be built with
+# -DSIM_HAVE_LZ4 to write them.
+CXXFLAGS="-O2 -std=c++14"
+LIBS=""
+if [ "$LZ4" == "1" ]
+then
+    CXXFLAGS="$CXXFLAGS -DSIM_HAVE_LZ4=1"
+    LIBS="-llz4"
+fi
+
+python3 ../scripts/make_instruction_names.py
+
+mkdir -p obj_tools
+g++ $CXXFLAGS retire_decode.cpp -o obj_tools/retire_decode $LIBS
+g++ $CXXFLAGS bus_query.cpp -o obj_tools/bus_query
+g++ $CXXFLAGS sim_diff.cpp -o obj_tools/sim_diff $LIBS
@@ -0,0 +1,106 @@
+// Bus transaction log: one packed record per memory read or write serviced
+// by the harness, appended to a file in cycle order.
+//
+// The file is a BusLogHeader followed by the records, never compressed, so
+// tools can mmap it and binary search by cycle (see bus_query.cpp). It
+// replaces hand-written watches on address_out: log a run once, then ask
+// e.g. which instruction last wrote a RAM byte before a given cycle.
+//
+// Records are written in the byte order of the host.
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+
+#define BUS_LOG_VERSION 1
+
+#define BUS_LOG_WRITE 0x1
+// Set if the PRC owned the bus (bus_ack), otherwise it was the cpu.
+#define BUS_LOG_PRC 0x2
+
+// Records are buffered and written in blocks of this many.
+#define BUS_LOG_BLOCK_RECORDS 65536
+
+struct BusLogHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    uint64_t reserved;
+};
+
+struct BusRecord
+{
+    uint64_t cycle;
+    uint32_t address;
+
+    // Address of the instruction the cpu was executing, meaningless for
+    // PRC transactions.
+    uint16_t top_address;
+
+    uint8_t data;
+    uint8_t flags;
+};
+
+static_assert(sizeof(BusLogHeader) == 24, "BusLogHeader must be packed");
+static_assert(sizeof(BusRecord) == 16, "BusRecord must be packed");
+
+struct BusLog
+{
+    FILE* fp;
+    BusRecord* records;
+    uint32_t num_records;
+    uint64_t total_records;
+};
+
+BusLog* bus_log_open(const char* filepath)
+{
+    FILE* fp = fopen(filepath, "wb");
+    if(!fp)
+    {
+        fprintf(stderr, "Error opening bus log %s.\n", filepath);
+        return nullptr;
+    }
+
+    BusLogHeader header = {};
+    memcpy(header.magic, "MINXBUS", 8);
+    header.version     = BUS_LOG_VERSION;
+    header.record_size = sizeof(BusRecord);
+    fwrite(&header, sizeof(header), 1, fp);
+
+    BusLog* log = (BusLog*) calloc(1, sizeof(BusLog));
+    log->fp      = fp;
+    log->records = (BusRecord*) malloc(sizeof(BusRecord) * BUS_LOG_BLOCK_RECORDS);
+    return log;
+}
+
+void bus_log_flush(BusLog* log)
+{
+    fwrite(log->records, sizeof(BusRecord), log->num_records, log->fp);
+    fflush(log->fp);
+    log->num_records = 0;
+}
+
+static inline void bus_log_append(BusLog* log, uint64_t cycle, uint32_t address, uint8_t data, uint16_t top_address, uint8_t flags)
+{
+    if(log->num_records == BUS_LOG_BLOCK_RECORDS)
+        bus_log_flush(log);
+
+    BusRecord* record = log->records + log->num_records++;
+    record->cycle       = cycle;
+    record->address     = address;
+    record->top_address = top_address;
+    record->data        = data;
+    record->flags       = flags;
+    ++log->total_records;
+}
+
+void bus_log_close(BusLog* log)
+{
+    bus_log_flush(log);
+    fclose(log->fp);
+    free(log->records);
+    free(log);
+}
@@ -0,0 +1,323 @@
+#include "bus_log.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Answers questions about a bus log (see bus_log.h) without rerunning the
+// simulation. The log is mmapped and searched by cycle in place.
+//
+// Usage: bus_query log.bus last-write address [cycle]
+//        bus_query log.bus writes address [first_cycle [last_cycle]]
+//        bus_query log.bus reads address [first_cycle [last_cycle]]
+//        bus_query log.bus range first_cycle last_cycle
+//
+// last-write prints the last write to the address at or before the cycle
+// (the end of the log by default), i.e. who put the value there. writes
+// and reads list the accesses to an address, range every transaction in a
+// window of cycles.
+//
+// writes, reads and range scan the records of the window they are given.
+// last-write on a RAM address uses an index kept next to the log in
+// <log>.idx, built on the first query (one pass over the log): every
+// BUS_INDEX_INTERVAL records it holds the last write so far to each RAM
+// byte, so a query scans back at most that many records. Other addresses
+// have no index and are scanned back from the cycle, up to the whole log.
+
+struct BusLogView
+{
+    const BusRecord* records;
+    size_t num_records;
+    void* mapping;
+    size_t mapping_size;
+    int64_t mtime;
+};
+
+bool bus_log_map(BusLogView* view, const char* filepath)
+{
+    int fd = open(filepath, O_RDONLY);
+    if(fd < 0)
+    {
+        fprintf(stderr, "Error opening bus log %s.\n", filepath);
+        return false;
+    }
+
+    struct stat st;
+    fstat(fd, &st);
+    if((size_t)st.st_size < sizeof(BusLogHeader))
+    {
+        fprintf(stderr, "%s is not a bus log.\n", filepath);
+        close(fd);
+        return false;
+    }
+
+    view->mapping_size = st.st_size;
+    view->mtime        = (int64_t) st.st_mtime;
+    view->mapping = mmap(nullptr, view->mapping_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(view->mapping == MAP_FAILED)
+    {
+        fprintf(stderr, "Error mapping bus log %s.\n", filepath);
+        return false;
+    }
+
+    const BusLogHeader* header = (const BusLogHeader*) view->mapping;
+    if(memcmp(header->magic, "MINXBUS", 8) != 0 || header->version != BUS_LOG_VERSION || header->record_size != sizeof(BusRecord))
+    {
+        fprintf(stderr, "%s is not a version %u bus log.\n", filepath, BUS_LOG_VERSION);
+        munmap(view->mapping, view->mapping_size);
+        return false;
+    }
+
+    view->records = (const BusRecord*)((const uint8_t*) view->mapping + sizeof(BusLogHeader));
+    view->num_records = (view->mapping_size - sizeof(BusLogHeader)) / sizeof(BusRecord);
+    return true;
+}
+
+#define BUS_INDEX_VERSION 1
+#define BUS_INDEX_INTERVAL 65536
+#define BUS_INDEX_RAM_START 0x1000
+#define BUS_INDEX_RAM_SIZE 0x1000
+
+struct BusIndexHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t interval;
+    uint64_t num_records;
+    // Of the log the index was built for.
+    int64_t log_mtime;
+};
+
+static_assert(sizeof(BusIndexHeader) == 32, "BusIndexHeader must be packed");
+
+// Checkpoint c holds, for each RAM byte, 1 + the index of the last write
+// to it before record c * BUS_INDEX_INTERVAL, 0 if there was none.
+struct BusIndex
+{
+    const uint64_t* checkpoints;
+    size_t num_checkpoints;
+    void* mapping;
+    size_t mapping_size;
+    uint64_t* owned;
+};
+
+static size_t bus_index_num_checkpoints(size_t num_records)
+{
+    return num_records / BUS_INDEX_INTERVAL + 1;
+}
+
+// Maps <log>.idx if it was built for this log, otherwise builds it and
+// tries to save it for the next query.
+bool bus_index_open(BusIndex* index, const BusLogView* view, const char* log_filepath)
+{
+    char filepath[512];
+    snprintf(filepath, sizeof(filepath), "%s.idx", log_filepath);
+    size_t num_checkpoints = bus_index_num_checkpoints(view->num_records);
+    size_t table_size = num_checkpoints * BUS_INDEX_RAM_SIZE * sizeof(uint64_t);
+    memset(index, 0, sizeof(*index));
+    index->num_checkpoints = num_checkpoints;
+
+    int fd = open(filepath, O_RDONLY);
+    if(fd >= 0)
+    {
+        struct stat st;
+        if(fstat(fd, &st) == 0 && (size_t)st.st_size == sizeof(BusIndexHeader) + table_size)
+        {
+            void* mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            const BusIndexHeader* header = (const BusIndexHeader*) mapping;
+            if(mapping != MAP_FAILED &&
+               memcmp(header->magic, "MINXBIX", 8) == 0 &&
+               header->version == BUS_INDEX_VERSION &&
+               header->interval == BUS_INDEX_INTERVAL &&
+               header->num_records == view->num_records &&
+               header->log_mtime == view->mtime)
+            {
+                close(fd);
+                index->mapping      = mapping;
+                index->mapping_size = st.st_size;
+                index->checkpoints  = (const uint64_t*)((const uint8_t*) mapping + sizeof(BusIndexHeader));
+                return true;
+            }
+            if(mapping != MAP_FAILED)
+                munmap(mapping, st.st_size);
+        }
+        close(fd);
+    }
+
+    uint64_t* checkpoints = (uint64_t*) malloc(table_size);
+    if(!checkpoints)
+    {
+        fprintf(stderr, "Not enough memory for the index of %s.\n", log_filepath);
+        return false;
+    }
+    uint64_t last_write[BUS_INDEX_RAM_SIZE] = {};
+    for(size_t i = 0; i <= view->num_records; ++i)
+    {
+        if(i % BUS_INDEX_INTERVAL == 0)
+            memcpy(checkpoints + (i / BUS_INDEX_INTERVAL) * BUS_INDEX_RAM_SIZE, last_write, sizeof(last_write));
+        if(i == view->num_records)
+            break;
+
+        const BusRecord* record = &view->records[i];
+        uint32_t offset = record->address - BUS_INDEX_RAM_START;
+        if((record->flags & BUS_LOG_WRITE) && offset < BUS_INDEX_RAM_SIZE)
+            last_write[offset] = i + 1;
+    }
+    index->owned       = checkpoints;
+    index->checkpoints = checkpoints;
+
+    // Written under a name of its own and renamed, so a query running at
+    // the same time never maps half an index.
+    char temp_filepath[532];
+    snprintf(temp_filepath, sizeof(temp_filepath), "%s.XXXXXX", filepath);
+    fd = mkstemp(temp_filepath);
+    if(fd >= 0)
+    {
+        fchmod(fd, 0644);
+        FILE* fp = fdopen(fd, "wb");
+        BusIndexHeader header = {};
+        memcpy(header.magic, "MINXBIX", 8);
+        header.version     = BUS_INDEX_VERSION;
+        header.interval    = BUS_INDEX_INTERVAL;
+        header.num_records = view->num_records;
+        header.log_mtime   = view->mtime;
+        bool written = fwrite(&header, sizeof(header), 1, fp) == 1 &&
+                       fwrite(checkpoints, table_size, 1, fp) == 1;
+        written = (fclose(fp) == 0) && written;
+        if(!written || rename(temp_filepath, filepath) != 0)
+            unlink(temp_filepath);
+    }
+    return true;
+}
+
+void bus_index_close(BusIndex* index)
+{
+    if(index->mapping)
+        munmap(index->mapping, index->mapping_size);
+    free(index->owned);
+}
+
+// Index of the first record at or after the cycle.
+size_t bus_log_find(const BusLogView* view, uint64_t cycle)
+{
+    const BusRecord* end = view->records + view->num_records;
+    const BusRecord* it = std::lower_bound(view->records, end, cycle,
+        [](const BusRecord& record, uint64_t cycle){ return record.cycle < cycle; });
+    return it - view->records;
+}
+
+void print_record(const BusRecord* record)
+{
+    printf("%12llu %-5s %06X %02X  %s",
+        (unsigned long long)record->cycle,
+        (record->flags & BUS_LOG_WRITE)? "write": "read",
+        record->address,
+        record->data,
+        (record->flags & BUS_LOG_PRC)? "prc": "cpu");
+    if(!(record->flags & BUS_LOG_PRC))
+        printf(" at %04X", record->top_address);
+    printf("\n");
+}
+
+int main(int argc, char** argv)
+{
+    if(argc < 4)
+    {
+        fprintf(stderr, "Usage: %s log.bus last-write address [cycle]\n", argv[0]);
+        fprintf(stderr, "       %s log.bus writes|reads address [first_cycle [last_cycle]]\n", argv[0]);
+        fprintf(stderr, "       %s log.bus range first_cycle last_cycle\n", argv[0]);
+        return -1;
+    }
+
+    BusLogView view;
+    if(!bus_log_map(&view, argv[1]))
+        return -1;
+
+    auto start = std::chrono::steady_clock::now();
+    const char* command = argv[2];
+    uint64_t value = strtoull(argv[3], nullptr, 0);
+    uint64_t first_cycle = (argc > 4)? strtoull(argv[4], nullptr, 0): 0;
+    uint64_t last_cycle  = (argc > 5)? strtoull(argv[5], nullptr, 0): UINT64_MAX;
+    size_t num_found = 0;
+
+    if(strcmp(command, "last-write") == 0)
+    {
+        uint64_t cycle = (argc > 4)? first_cycle: UINT64_MAX;
+        size_t end = (cycle == UINT64_MAX)? view.num_records: bus_log_find(&view, cycle + 1);
+
+        // RAM addresses only scan back to the checkpoint before end.
+        BusIndex index;
+        size_t begin = 0;
+        bool indexed = value - BUS_INDEX_RAM_START < BUS_INDEX_RAM_SIZE && bus_index_open(&index, &view, argv[1]);
+        if(indexed)
+            begin = (end / BUS_INDEX_INTERVAL) * BUS_INDEX_INTERVAL;
+
+        for(size_t i = end; i-- > begin;)
+        {
+            const BusRecord* record = &view.records[i];
+            if((record->flags & BUS_LOG_WRITE) && record->address == value)
+            {
+                print_record(record);
+                num_found = 1;
+                break;
+            }
+        }
+        if(indexed)
+        {
+            uint64_t last_write = index.checkpoints[(end / BUS_INDEX_INTERVAL) * BUS_INDEX_RAM_SIZE + (value - BUS_INDEX_RAM_START)];
+            if(!num_found && last_write > 0)
+            {
+                print_record(&view.records[last_write - 1]);
+                num_found = 1;
+            }
+            bus_index_close(&index);
+        }
+    }
+    else if(strcmp(command, "writes") == 0 || strcmp(command, "reads") == 0)
+    {
+        uint8_t write = (strcmp(command, "writes") == 0)? BUS_LOG_WRITE: 0;
+        for(size_t i = bus_log_find(&view, first_cycle); i < view.num_records && view.records[i].cycle <= last_cycle; ++i)
+        {
+            const BusRecord* record = &view.records[i];
+            if((record->flags & BUS_LOG_WRITE) == write && record->address == value)
+            {
+                print_record(record);
+                ++num_found;
+            }
+        }
+    }
+    else if(strcmp(command, "range") == 0)
+    {
+        if(argc < 5)
+        {
+            fprintf(stderr, "Usage: %s log.bus range first_cycle last_cycle\n", argv[0]);
+            munmap(view.mapping, view.mapping_size);
+            return -1;
+        }
+
+        // range first_cycle last_cycle
+        uint64_t range_first = value;
+        uint64_t range_last  = first_cycle;
+        for(size_t i = bus_log_find(&view, range_first); i < view.num_records && view.records[i].cycle <= range_last; ++i)
+        {
+            print_record(&view.records[i]);
+            ++num_found;
+        }
+    }
+    else
+    {
+        fprintf(stderr, "Unknown command %s.\n", command);
+        munmap(view.mapping, view.mapping_size);
+        return -1;
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    fprintf(stderr, "%zu of %zu transactions, %.3f ms.\n", num_found, view.num_records, 1000.0 * std::chrono::duration<double>(end - start).count());
+
+    munmap(view.mapping, view.mapping_size);
+    return 0;
+}
@@ -0,0 +1,122 @@
+// Eeprom file: the 8KB eeprom of a cartridge kept in a file mapped into
+// memory, so saves persist across runs, see sim_open_eeprom().
+//
+// The model owns the eeprom array, so the mapping is a copy of it that the
+// harness keeps up to date: eeprom_file_update() copies the 256 byte blocks
+// that changed and marks them dirty, eeprom_file_flush() hands the dirty
+// pages to the kernel with msync(). Neither makes a system call unless
+// something changed. The file is the raw eeprom, as dumped by
+// sim_dump_eeprom().
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define EEPROM_FILE_SIZE 8192
+#define EEPROM_FILE_BLOCK_SHIFT 8
+
+static_assert((EEPROM_FILE_SIZE >> EEPROM_FILE_BLOCK_SHIFT) <= 32, "The dirty blocks must fit in a mask");
+
+struct EepromFile
+{
+    uint8_t* data;
+    // One bit per block changed since the last flush.
+    uint32_t dirty;
+    size_t page_size;
+};
+
+// Maps the file, creating it if it doesn't exist. is_new tells if it was
+// empty, in which case the caller fills it in.
+EepromFile* eeprom_file_open(const char* filepath, bool* is_new)
+{
+    int fd = open(filepath, O_RDWR | O_CREAT, 0666);
+    if(fd < 0)
+    {
+        fprintf(stderr, "Error opening eeprom %s.\n", filepath);
+        return nullptr;
+    }
+
+    struct stat st;
+    if(fstat(fd, &st) != 0)
+    {
+        fprintf(stderr, "Error reading the size of eeprom %s.\n", filepath);
+        close(fd);
+        return nullptr;
+    }
+
+    // Only a new, empty file is sized; anything else of the wrong size
+    // isn't an eeprom and is left alone.
+    *is_new = st.st_size == 0;
+    if(*is_new && ftruncate(fd, EEPROM_FILE_SIZE) != 0)
+    {
+        fprintf(stderr, "Error resizing eeprom %s.\n", filepath);
+        close(fd);
+        return nullptr;
+    }
+    if(!*is_new && st.st_size != EEPROM_FILE_SIZE)
+    {
+        fprintf(stderr, "%s is %lld bytes, not an eeprom of %d bytes.\n", filepath, (long long)st.st_size, EEPROM_FILE_SIZE);
+        close(fd);
+        return nullptr;
+    }
+
+    void* data = mmap(nullptr, EEPROM_FILE_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if(data == MAP_FAILED)
+    {
+        fprintf(stderr, "Error mapping eeprom %s.\n", filepath);
+        return nullptr;
+    }
+
+    EepromFile* file = (EepromFile*) calloc(1, sizeof(EepromFile));
+    file->data      = (uint8_t*) data;
+    file->page_size = (size_t) sysconf(_SC_PAGESIZE);
+    return file;
+}
+
+// Copies the blocks of eeprom that differ from the mapping.
+void eeprom_file_update(EepromFile* file, const uint8_t* eeprom)
+{
+    const size_t block_size = 1 << EEPROM_FILE_BLOCK_SHIFT;
+    for(size_t offset = 0; offset < EEPROM_FILE_SIZE; offset += block_size)
+    {
+        if(memcmp(file->data + offset, eeprom + offset, block_size) != 0)
+        {
+            memcpy(file->data + offset, eeprom + offset, block_size);
+            file->dirty |= 1u << (offset >> EEPROM_FILE_BLOCK_SHIFT);
+        }
+    }
+}
+
+// Schedules the write back of the pages holding dirty blocks.
+void eeprom_file_flush(EepromFile* file)
+{
+    if(!file->dirty) return;
+
+    for(size_t offset = 0; offset < EEPROM_FILE_SIZE; offset += file->page_size)
+    {
+        size_t size = EEPROM_FILE_SIZE - offset;
+        if(size > file->page_size) size = file->page_size;
+
+        size_t num_blocks  = size >> EEPROM_FILE_BLOCK_SHIFT;
+        size_t first_block = offset >> EEPROM_FILE_BLOCK_SHIFT;
+        uint32_t mask = (num_blocks >= 32)? 0xFFFFFFFFu: ((1u << num_blocks) - 1) << first_block;
+        if(file->dirty & mask)
+            msync(file->data + offset, size, MS_ASYNC);
+    }
+    file->dirty = 0;
+}
+
+void eeprom_file_close(EepromFile* file)
+{
+    msync(file->data, EEPROM_FILE_SIZE, MS_SYNC);
+    munmap(file->data, EEPROM_FILE_SIZE);
+    free(file);
+}
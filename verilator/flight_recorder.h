@@ -0,0 +1,197 @@
+// Flight recorder: keeps the last few cycles of a set of signals in a ring
+// buffer in memory and only writes them out, as a VCD file, when something
+// goes wrong.
+//
+// A full trace slows the simulation down by an order of magnitude, and
+// finding the window around a bug means rerunning with a guessed dump_step.
+// The recorder instead stores one sample per cycle (a handful of loads and
+// stores) and, once triggered, keeps recording for post_trigger more cycles
+// before writing the whole buffer to disk. The result is the waveform
+// leading up to and following the failure, from a single run.
+//
+// The recorder knows nothing about the model; sim.h fills in the samples,
+// see sim_enable_flight_recorder().
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+
+struct FlightSignal
+{
+    const char* name;
+    uint8_t width;
+};
+
+struct FlightRecorder
+{
+    const FlightSignal* signals;
+    int num_signals;
+
+    // Ring buffer of capacity samples, each a timestamp and num_signals
+    // values.
+    uint32_t capacity;
+    uint32_t head;
+    uint32_t count;
+    uint64_t* timestamps;
+    uint64_t* values;
+
+    // Number of samples recorded after a trigger, and the number still to
+    // record before the pending dump is written (0 if none is pending).
+    uint32_t post_trigger;
+    uint32_t remaining;
+    uint64_t trigger_timestamp;
+    char reason[128];
+
+    // Dumps are written to filepath_000.vcd, filepath_001.vcd, ... up to
+    // max_dumps of them.
+    char filepath[256];
+    int num_dumps;
+    int max_dumps;
+};
+
+FlightRecorder* flight_recorder_create(const FlightSignal* signals, int num_signals, uint32_t capacity, uint32_t post_trigger, const char* filepath)
+{
+    if(capacity == 0) capacity = 1;
+    if(post_trigger >= capacity) post_trigger = capacity - 1;
+
+    FlightRecorder* recorder = (FlightRecorder*) calloc(1, sizeof(FlightRecorder));
+    recorder->signals      = signals;
+    recorder->num_signals  = num_signals;
+    recorder->capacity     = capacity;
+    recorder->timestamps   = (uint64_t*) malloc(sizeof(uint64_t) * capacity);
+    recorder->values       = (uint64_t*) malloc(sizeof(uint64_t) * capacity * num_signals);
+    recorder->post_trigger = post_trigger;
+    recorder->max_dumps    = 1;
+    snprintf(recorder->filepath, sizeof(recorder->filepath), "%s", filepath);
+    return recorder;
+}
+
+// Returns the row to fill with the values of the next sample. The oldest
+// sample is overwritten once the buffer is full.
+static inline uint64_t* flight_recorder_next(FlightRecorder* recorder, uint64_t timestamp)
+{
+    uint32_t index = recorder->head;
+    recorder->head = (recorder->head + 1 == recorder->capacity)? 0: recorder->head + 1;
+    if(recorder->count < recorder->capacity) ++recorder->count;
+
+    recorder->timestamps[index] = timestamp;
+    return recorder->values + (size_t)index * recorder->num_signals;
+}
+
+// Returns a short VCD identifier for the given signal index.
+static void flight_recorder_id(int index, char* id)
+{
+    do
+    {
+        *id++ = '!' + index % 94;
+        index /= 94;
+    }
+    while(index > 0);
+    *id = 0;
+}
+
+static void flight_recorder_write_value(FILE* fp, uint64_t value, uint8_t width, const char* id)
+{
+    if(width == 1)
+    {
+        fprintf(fp, "%c%s\n", (value & 1)? '1': '0', id);
+        return;
+    }
+
+    char bits[65];
+    for(int i = 0; i < width; ++i)
+        bits[i] = ((value >> (width - 1 - i)) & 1)? '1': '0';
+    bits[width] = 0;
+    fprintf(fp, "b%s %s\n", bits, id);
+}
+
+// Writes the contents of the ring buffer, oldest sample first. Time is the
+// timestamp passed to flight_recorder_next(), written with the timescale
+// of the Verilator dumps so both line up in a viewer.
+bool flight_recorder_write_vcd(const FlightRecorder* recorder, const char* filepath)
+{
+    FILE* fp = fopen(filepath, "w");
+    if(!fp) return false;
+
+    fprintf(fp, "$comment %s at %llu $end\n", recorder->reason, (unsigned long long)recorder->trigger_timestamp);
+    fprintf(fp, "$timescale 1ps $end\n");
+    fprintf(fp, "$scope module minx $end\n");
+    char id[8];
+    for(int s = 0; s < recorder->num_signals; ++s)
+    {
+        flight_recorder_id(s, id);
+        fprintf(fp, "$var wire %d %s %s $end\n", recorder->signals[s].width, id, recorder->signals[s].name);
+    }
+    fprintf(fp, "$upscope $end\n");
+    fprintf(fp, "$enddefinitions $end\n");
+
+    uint32_t first = (recorder->head + recorder->capacity - recorder->count) % recorder->capacity;
+    const uint64_t* previous = nullptr;
+    for(uint32_t i = 0; i < recorder->count; ++i)
+    {
+        uint32_t index = (first + i) % recorder->capacity;
+        const uint64_t* row = recorder->values + (size_t)index * recorder->num_signals;
+
+        fprintf(fp, "#%llu\n", (unsigned long long)recorder->timestamps[index]);
+        for(int s = 0; s < recorder->num_signals; ++s)
+        {
+            if(previous && previous[s] == row[s]) continue;
+            flight_recorder_id(s, id);
+            flight_recorder_write_value(fp, row[s], recorder->signals[s].width, id);
+        }
+        previous = row;
+    }
+
+    fclose(fp);
+    return true;
+}
+
+// Writes the pending dump, if any, with whatever has been recorded so far.
+void flight_recorder_flush(FlightRecorder* recorder)
+{
+    if(!recorder->reason[0] || recorder->num_dumps >= recorder->max_dumps)
+        return;
+
+    char path[300];
+    snprintf(path, sizeof(path), "%s_%03d.vcd", recorder->filepath, recorder->num_dumps);
+    if(flight_recorder_write_vcd(recorder, path))
+        printf("Flight recorder: %s at %llu, wrote %u cycles to %s.\n", recorder->reason, (unsigned long long)recorder->trigger_timestamp, recorder->count, path);
+    else
+        fprintf(stderr, "Error writing flight recorder dump %s.\n", path);
+
+    ++recorder->num_dumps;
+    recorder->reason[0] = 0;
+    recorder->remaining = 0;
+}
+
+// Arms a dump, written once post_trigger more samples have been recorded.
+// Triggers while a dump is pending, or after max_dumps, are ignored.
+void flight_recorder_trigger(FlightRecorder* recorder, uint64_t timestamp, const char* reason)
+{
+    if(recorder->reason[0] || recorder->num_dumps >= recorder->max_dumps)
+        return;
+
+    recorder->trigger_timestamp = timestamp;
+    snprintf(recorder->reason, sizeof(recorder->reason), "%s", reason);
+    recorder->remaining = recorder->post_trigger;
+    if(recorder->remaining == 0)
+        flight_recorder_flush(recorder);
+}
+
+// Called after each sample, writes the pending dump once post_trigger
+// samples have been recorded since the trigger.
+static inline void flight_recorder_step(FlightRecorder* recorder)
+{
+    if(recorder->remaining > 0 && --recorder->remaining == 0)
+        flight_recorder_flush(recorder);
+}
+
+void flight_recorder_destroy(FlightRecorder* recorder)
+{
+    flight_recorder_flush(recorder);
+    free(recorder->timestamps);
+    free(recorder->values);
+    free(recorder);
+}
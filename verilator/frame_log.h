@@ -0,0 +1,59 @@
+// Frame log: every framebuffer captured by simulate_steps(), with the frame
+// number and the cycle it completed on.
+//
+// The file is a FrameLogHeader followed by one FrameRecord per frame, in
+// the byte order of the host. Used by sim_diff to find the first frame two
+// runs disagree on.
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+
+#define FRAME_LOG_VERSION 1
+
+struct FrameLogHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    uint64_t reserved;
+};
+
+struct FrameRecord
+{
+    uint64_t cycle;
+    uint32_t frame;
+    uint32_t reserved;
+    uint8_t data[768];
+};
+
+static_assert(sizeof(FrameLogHeader) == 24, "FrameLogHeader must be packed");
+static_assert(sizeof(FrameRecord) == 784, "FrameRecord must be packed");
+
+FILE* frame_log_open(const char* filepath)
+{
+    FILE* fp = fopen(filepath, "wb");
+    if(!fp)
+    {
+        fprintf(stderr, "Error opening frame log %s.\n", filepath);
+        return nullptr;
+    }
+
+    FrameLogHeader header = {};
+    memcpy(header.magic, "MINXFRM", 8);
+    header.version     = FRAME_LOG_VERSION;
+    header.record_size = sizeof(FrameRecord);
+    fwrite(&header, sizeof(header), 1, fp);
+    return fp;
+}
+
+void frame_log_append(FILE* fp, uint64_t cycle, uint32_t frame, const uint8_t* framebuffer)
+{
+    FrameRecord record = {};
+    record.cycle = cycle;
+    record.frame = frame;
+    memcpy(record.data, framebuffer, sizeof(record.data));
+    fwrite(&record, sizeof(record), 1, fp);
+}
@@ -0,0 +1,771 @@
+// Generated by scripts/make_instruction_names.py, do not edit.
+const char* instruction_names[768] = {
+    "8-bit ADD", // 0x000
+    "8-bit ADD", // 0x001
+    "8-bit ADD", // 0x002
+    "8-bit ADD", // 0x003
+    "8-bit ADD", // 0x004
+    "8-bit ADD", // 0x005
+    "8-bit ADD", // 0x006
+    "8-bit ADD", // 0x007
+    "8-bit ADC", // 0x008
+    "8-bit ADC", // 0x009
+    "8-bit ADC", // 0x00A
+    "8-bit ADC", // 0x00B
+    "8-bit ADC", // 0x00C
+    "8-bit ADC", // 0x00D
+    "8-bit ADC", // 0x00E
+    "8-bit ADC", // 0x00F
+    "8-bit SUB", // 0x010
+    "8-bit SUB", // 0x011
+    "8-bit SUB", // 0x012
+    "8-bit SUB", // 0x013
+    "8-bit SUB", // 0x014
+    "8-bit SUB", // 0x015
+    "8-bit SUB", // 0x016
+    "8-bit SUB", // 0x017
+    "8-bit SBC", // 0x018
+    "8-bit SBC", // 0x019
+    "8-bit SBC", // 0x01A
+    "8-bit SBC", // 0x01B
+    "8-bit SBC", // 0x01C
+    "8-bit SBC", // 0x01D
+    "8-bit SBC", // 0x01E
+    "8-bit SBC", // 0x01F
+    "8-bit AND", // 0x020
+    "8-bit AND", // 0x021
+    "8-bit AND", // 0x022
+    "8-bit AND", // 0x023
+    "8-bit AND", // 0x024
+    "8-bit AND", // 0x025
+    "8-bit AND", // 0x026
+    "8-bit AND", // 0x027
+    "8-bit OR", // 0x028
+    "8-bit OR", // 0x029
+    "8-bit OR", // 0x02A
+    "8-bit OR", // 0x02B
+    "8-bit OR", // 0x02C
+    "8-bit OR", // 0x02D
+    "8-bit OR", // 0x02E
+    "8-bit OR", // 0x02F
+    "8-bit CMP", // 0x030
+    "8-bit CMP", // 0x031
+    "8-bit CMP", // 0x032
+    "8-bit CMP", // 0x033
+    "8-bit CMP", // 0x034
+    "8-bit CMP", // 0x035
+    "8-bit CMP", // 0x036
+    "8-bit CMP", // 0x037
+    "8-bit XOR", // 0x038
+    "8-bit XOR", // 0x039
+    "8-bit XOR", // 0x03A
+    "8-bit XOR", // 0x03B
+    "8-bit XOR", // 0x03C
+    "8-bit XOR", // 0x03D
+    "8-bit XOR", // 0x03E
+    "8-bit XOR", // 0x03F
+    "8-bit Load to A", // 0x040
+    "8-bit Load to A", // 0x041
+    "8-bit Load to A", // 0x042
+    "8-bit Load to A", // 0x043
+    "8-bit Load to A", // 0x044
+    "8-bit Load to A", // 0x045
+    "8-bit Load to A", // 0x046
+    "8-bit Load to A", // 0x047
+    "8-bit Load to B", // 0x048
+    "8-bit Load to B", // 0x049
+    "8-bit Load to B", // 0x04A
+    "8-bit Load to B", // 0x04B
+    "8-bit Load to B", // 0x04C
+    "8-bit Load to B", // 0x04D
+    "8-bit Load to B", // 0x04E
+    "8-bit Load to B", // 0x04F
+    "8-bit Load to L", // 0x050
+    "8-bit Load to L", // 0x051
+    "8-bit Load to L", // 0x052
+    "8-bit Load to L", // 0x053
+    "8-bit Load to L", // 0x054
+    "8-bit Load to L", // 0x055
+    "8-bit Load to L", // 0x056
+    "8-bit Load to L", // 0x057
+    "8-bit Load to H", // 0x058
+    "8-bit Load to H", // 0x059
+    "8-bit Load to H", // 0x05A
+    "8-bit Load to H", // 0x05B
+    "8-bit Load to H", // 0x05C
+    "8-bit Load to H", // 0x05D
+    "8-bit Load to H", // 0x05E
+    "8-bit Load to H", // 0x05F
+    "8-bit Load to IX", // 0x060
+    "8-bit Load to IX", // 0x061
+    "8-bit Load to IX", // 0x062
+    "8-bit Load to IX", // 0x063
+    "8-bit Load to IX", // 0x064
+    "8-bit Load to IX", // 0x065
+    "8-bit Load to IX", // 0x066
+    "8-bit Load to IX", // 0x067
+    "8-bit Load to HL", // 0x068
+    "8-bit Load to HL", // 0x069
+    "8-bit Load to HL", // 0x06A
+    "8-bit Load to HL", // 0x06B
+    "8-bit Load to HL", // 0x06C
+    "8-bit Load to HL", // 0x06D
+    "8-bit Load to HL", // 0x06E
+    "8-bit Load to HL", // 0x06F
+    "8-bit Load to IY", // 0x070
+    "8-bit Load to IY", // 0x071
+    "8-bit Load to IY", // 0x072
+    "8-bit Load to IY", // 0x073
+    "8-bit Load to IY", // 0x074
+    "8-bit Load to IY", // 0x075
+    "8-bit Load to IY", // 0x076
+    "8-bit Load to IY", // 0x077
+    "8-bit Load to BR:ll", // 0x078
+    "8-bit Load to BR:ll", // 0x079
+    "8-bit Load to BR:ll", // 0x07A
+    "8-bit Load to BR:ll", // 0x07B
+    nullptr, // 0x07C
+    "8-bit Load to BR:ll", // 0x07D
+    "8-bit Load to BR:ll", // 0x07E
+    "8-bit Load to BR:ll", // 0x07F
+    "8-bit INC", // 0x080
+    "8-bit INC", // 0x081
+    "8-bit INC", // 0x082
+    "8-bit INC", // 0x083
+    "8-bit INC", // 0x084
+    "8-bit INC", // 0x085
+    "8-bit INC", // 0x086
+    "16-bit INC", // 0x087
+    "8-bit DEC", // 0x088
+    "8-bit DEC", // 0x089
+    "8-bit DEC", // 0x08A
+    "8-bit DEC", // 0x08B
+    "8-bit DEC", // 0x08C
+    "8-bit DEC", // 0x08D
+    "8-bit DEC", // 0x08E
+    "16-bit DEC", // 0x08F
+    "16-bit INC", // 0x090
+    "16-bit INC", // 0x091
+    "16-bit INC", // 0x092
+    "16-bit INC", // 0x093
+    "8-bit BIT", // 0x094
+    "8-bit BIT", // 0x095
+    "8-bit BIT", // 0x096
+    "8-bit BIT", // 0x097
+    "16-bit DEC", // 0x098
+    "16-bit DEC", // 0x099
+    "16-bit DEC", // 0x09A
+    "16-bit DEC", // 0x09B
+    "8-bit AND", // 0x09C
+    "8-bit OR", // 0x09D
+    "8-bit XOR", // 0x09E
+    "8-bit Load to SC", // 0x09F
+    "PUSH", // 0x0A0
+    "PUSH", // 0x0A1
+    "PUSH", // 0x0A2
+    "PUSH", // 0x0A3
+    "PUSH", // 0x0A4
+    "PUSH", // 0x0A5
+    "PUSH", // 0x0A6
+    "PUSH", // 0x0A7
+    "POP", // 0x0A8
+    "POP", // 0x0A9
+    "POP", // 0x0AA
+    "POP", // 0x0AB
+    "POP", // 0x0AC
+    "POP", // 0x0AD
+    "POP", // 0x0AE
+    "POP", // 0x0AF
+    "8-bit Load to A", // 0x0B0
+    "8-bit Load to B", // 0x0B1
+    "8-bit Load to L", // 0x0B2
+    "8-bit Load to H", // 0x0B3
+    "8-bit Load to BR", // 0x0B4
+    "8-bit Load to HL", // 0x0B5
+    "8-bit Load to IX", // 0x0B6
+    "8-bit Load to IY", // 0x0B7
+    "#CFF9", // 0x0B8
+    "#CFF5", // 0x0B9
+    "16-bit Load to IX", // 0x0BA
+    "16-bit Load to IY", // 0x0BB
+    "16-bit Load to hhll", // 0x0BC
+    "16-bit Load to hhll", // 0x0BD
+    "16-bit Load to hhll", // 0x0BE
+    "16-bit Load to hhll", // 0x0BF
+    "16-bit ADD", // 0x0C0
+    "16-bit ADD", // 0x0C1
+    "16-bit ADD", // 0x0C2
+    "16-bit ADD", // 0x0C3
+    "#CFF9", // 0x0C4
+    "#CFF5", // 0x0C5
+    "16-bit Load to IX", // 0x0C6
+    "16-bit Load to IY", // 0x0C7
+    "16-bit EX", // 0x0C8
+    "16-bit EX", // 0x0C9
+    "16-bit EX", // 0x0CA
+    "16-bit EX", // 0x0CB
+    "8-bit EX", // 0x0CC
+    "8-bit EX", // 0x0CD
+    nullptr, // 0x0CE
+    nullptr, // 0x0CF
+    "16-bit SUB", // 0x0D0
+    "16-bit SUB", // 0x0D1
+    "16-bit SUB", // 0x0D2
+    "16-bit SUB", // 0x0D3
+    "16-bit CMP", // 0x0D4
+    "16-bit CMP", // 0x0D5
+    "16-bit CMP", // 0x0D6
+    "16-bit CMP", // 0x0D7
+    "8-bit AND", // 0x0D8
+    "8-bit OR", // 0x0D9
+    "8-bit XOR", // 0x0DA
+    "8-bit CMP", // 0x0DB
+    "8-bit BIT", // 0x0DC
+    "8-bit Load to BR:ll", // 0x0DD
+    "Auxiliary operations", // 0x0DE
+    "Auxiliary operations", // 0x0DF
+    "CARS rr", // 0x0E0
+    "CARS rr", // 0x0E1
+    "CARS rr", // 0x0E2
+    "CARS rr", // 0x0E3
+    "JRS C rr", // 0x0E4
+    "JRS C rr", // 0x0E5
+    "JRS C rr", // 0x0E6
+    "JRS C rr", // 0x0E7
+    "CARL qqrr", // 0x0E8
+    "CARL qqrr", // 0x0E9
+    "CARL qqrr", // 0x0EA
+    "CARL qqrr", // 0x0EB
+    "JRL", // 0x0EC
+    "JRL", // 0x0ED
+    "JRL", // 0x0EE
+    "JRL", // 0x0EF
+    "CARS rr", // 0x0F0
+    "JRS", // 0x0F1
+    "CARL qqrr", // 0x0F2
+    "JRL", // 0x0F3
+    "JP", // 0x0F4
+    "DJR rr", // 0x0F5
+    "8-bit SWAP", // 0x0F6
+    "8-bit SWAP", // 0x0F7
+    "RET", // 0x0F8
+    "RETE", // 0x0F9
+    "RETS", // 0x0FA
+    "CALL [hhll]", // 0x0FB
+    "INT", // 0x0FC
+    "INT", // 0x0FD
+    nullptr, // 0x0FE
+    nullptr, // 0x0FF
+    "8-bit ADD", // 0x100
+    "8-bit ADD", // 0x101
+    "8-bit ADD", // 0x102
+    "8-bit ADD", // 0x103
+    "8-bit ADD", // 0x104
+    "8-bit ADD", // 0x105
+    "8-bit ADD", // 0x106
+    "8-bit ADD", // 0x107
+    "8-bit ADC", // 0x108
+    "8-bit ADC", // 0x109
+    "8-bit ADC", // 0x10A
+    "8-bit ADC", // 0x10B
+    "8-bit ADC", // 0x10C
+    "8-bit ADC", // 0x10D
+    "8-bit ADC", // 0x10E
+    "8-bit ADC", // 0x10F
+    "8-bit SUB", // 0x110
+    "8-bit SUB", // 0x111
+    "8-bit SUB", // 0x112
+    "8-bit SUB", // 0x113
+    "8-bit SUB", // 0x114
+    "8-bit SUB", // 0x115
+    "8-bit SUB", // 0x116
+    "8-bit SUB", // 0x117
+    "8-bit SBC", // 0x118
+    "8-bit SBC", // 0x119
+    "8-bit SBC", // 0x11A
+    "8-bit SBC", // 0x11B
+    "8-bit SBC", // 0x11C
+    "8-bit SBC", // 0x11D
+    "8-bit SBC", // 0x11E
+    "8-bit SBC", // 0x11F
+    "8-bit AND", // 0x120
+    "8-bit AND", // 0x121
+    "8-bit AND", // 0x122
+    "8-bit AND", // 0x123
+    "8-bit AND", // 0x124
+    "8-bit AND", // 0x125
+    "8-bit AND", // 0x126
+    "8-bit AND", // 0x127
+    "8-bit OR", // 0x128
+    "8-bit OR", // 0x129
+    "8-bit OR", // 0x12A
+    "8-bit OR", // 0x12B
+    "8-bit OR", // 0x12C
+    "8-bit OR", // 0x12D
+    "8-bit OR", // 0x12E
+    "8-bit OR", // 0x12F
+    "8-bit CMP", // 0x130
+    "8-bit CMP", // 0x131
+    "8-bit CMP", // 0x132
+    "8-bit CMP", // 0x133
+    "8-bit CMP", // 0x134
+    "8-bit CMP", // 0x135
+    "8-bit CMP", // 0x136
+    "8-bit CMP", // 0x137
+    "8-bit XOR", // 0x138
+    "8-bit XOR", // 0x139
+    "8-bit XOR", // 0x13A
+    "8-bit XOR", // 0x13B
+    "8-bit XOR", // 0x13C
+    "8-bit XOR", // 0x13D
+    "8-bit XOR", // 0x13E
+    "8-bit XOR", // 0x13F
+    "8-bit Load to A", // 0x140
+    "8-bit Load to A", // 0x141
+    "8-bit Load to A", // 0x142
+    "8-bit Load to A", // 0x143
+    "8-bit Load to IX+dd", // 0x144
+    "8-bit Load to IY+dd", // 0x145
+    "8-bit Load to IX+L", // 0x146
+    "8-bit Load to IY+L", // 0x147
+    "8-bit Load to B", // 0x148
+    "8-bit Load to B", // 0x149
+    "8-bit Load to B", // 0x14A
+    "8-bit Load to B", // 0x14B
+    "8-bit Load to IX+dd", // 0x14C
+    "8-bit Load to IY+dd", // 0x14D
+    "8-bit Load to IX+L", // 0x14E
+    "8-bit Load to IY+L", // 0x14F
+    "8-bit Load to L", // 0x150
+    "8-bit Load to L", // 0x151
+    "8-bit Load to L", // 0x152
+    "8-bit Load to L", // 0x153
+    "8-bit Load to IX+dd", // 0x154
+    "8-bit Load to IY+dd", // 0x155
+    "8-bit Load to IX+L", // 0x156
+    "8-bit Load to IY+L", // 0x157
+    "8-bit Load to H", // 0x158
+    "8-bit Load to H", // 0x159
+    "8-bit Load to H", // 0x15A
+    "8-bit Load to H", // 0x15B
+    "8-bit Load to IX+dd", // 0x15C
+    "8-bit Load to IY+dd", // 0x15D
+    "8-bit Load to IX+L", // 0x15E
+    "8-bit Load to IY+L", // 0x15F
+    "8-bit Load to HL", // 0x160
+    "8-bit Load to HL", // 0x161
+    "8-bit Load to HL", // 0x162
+    "8-bit Load to HL", // 0x163
+    nullptr, // 0x164
+    nullptr, // 0x165
+    nullptr, // 0x166
+    nullptr, // 0x167
+    "8-bit Load to IX", // 0x168
+    "8-bit Load to IX", // 0x169
+    "8-bit Load to IX", // 0x16A
+    "8-bit Load to IX", // 0x16B
+    nullptr, // 0x16C
+    nullptr, // 0x16D
+    nullptr, // 0x16E
+    nullptr, // 0x16F
+    nullptr, // 0x170
+    nullptr, // 0x171
+    nullptr, // 0x172
+    nullptr, // 0x173
+    nullptr, // 0x174
+    nullptr, // 0x175
+    nullptr, // 0x176
+    nullptr, // 0x177
+    "8-bit Load to IY", // 0x178
+    "8-bit Load to IY", // 0x179
+    "8-bit Load to IY", // 0x17A
+    "8-bit Load to IY", // 0x17B
+    nullptr, // 0x17C
+    nullptr, // 0x17D
+    nullptr, // 0x17E
+    nullptr, // 0x17F
+    "SLA", // 0x180
+    "SLA", // 0x181
+    "SLA", // 0x182
+    "SLA", // 0x183
+    "SLL", // 0x184
+    "SLL", // 0x185
+    "SLL", // 0x186
+    "SLL", // 0x187
+    "SRA", // 0x188
+    "SRA", // 0x189
+    "SRA", // 0x18A
+    "SRA", // 0x18B
+    "SRL", // 0x18C
+    "SRL", // 0x18D
+    "SRL", // 0x18E
+    "SRL", // 0x18F
+    "RL", // 0x190
+    "RL", // 0x191
+    "RL", // 0x192
+    "RL", // 0x193
+    "RLC", // 0x194
+    "RLC", // 0x195
+    "RLC", // 0x196
+    "RLC", // 0x197
+    "RR", // 0x198
+    "RR", // 0x199
+    "RR", // 0x19A
+    "RR", // 0x19B
+    "RRC", // 0x19C
+    "RRC", // 0x19D
+    "RRC", // 0x19E
+    "RRC", // 0x19F
+    "8-bit CPL", // 0x1A0
+    "8-bit CPL", // 0x1A1
+    "8-bit CPL", // 0x1A2
+    "8-bit CPL", // 0x1A3
+    "8-bit NEG", // 0x1A4
+    "8-bit NEG", // 0x1A5
+    "8-bit NEG", // 0x1A6
+    "8-bit NEG", // 0x1A7
+    "Auxiliary operations", // 0x1A8
+    nullptr, // 0x1A9
+    nullptr, // 0x1AA
+    nullptr, // 0x1AB
+    nullptr, // 0x1AC
+    nullptr, // 0x1AD
+    nullptr, // 0x1AE
+    nullptr, // 0x1AF
+    "8-bit AND", // 0x1B0
+    "8-bit AND", // 0x1B1
+    "8-bit AND", // 0x1B2
+    nullptr, // 0x1B3
+    "8-bit OR", // 0x1B4
+    "8-bit OR", // 0x1B5
+    "8-bit OR", // 0x1B6
+    nullptr, // 0x1B7
+    "8-bit XOR", // 0x1B8
+    "8-bit XOR", // 0x1B9
+    "8-bit XOR", // 0x1BA
+    nullptr, // 0x1BB
+    "8-bit CMP", // 0x1BC
+    "8-bit CMP", // 0x1BD
+    "8-bit CMP", // 0x1BE
+    "8-bit CMP", // 0x1BF
+    "8-bit Load to A", // 0x1C0
+    "8-bit Load to A", // 0x1C1
+    "8-bit Load to BR", // 0x1C2
+    "8-bit Load to SC", // 0x1C3
+    "8-bit Load to NB", // 0x1C4
+    "8-bit Load to EP", // 0x1C5
+    "8-bit Load to XP", // 0x1C6
+    "8-bit Load to YP", // 0x1C7
+    "8-bit Load to A", // 0x1C8
+    "8-bit Load to A", // 0x1C9
+    "8-bit Load to A", // 0x1CA
+    "8-bit Load to A", // 0x1CB
+    "8-bit Load to NB", // 0x1CC
+    "8-bit Load to EP", // 0x1CD
+    "8-bit Load to XP", // 0x1CE
+    "8-bit Load to YP", // 0x1CF
+    "8-bit Load to A", // 0x1D0
+    "8-bit Load to B", // 0x1D1
+    "8-bit Load to L", // 0x1D2
+    "8-bit Load to H", // 0x1D3
+    "8-bit Load to hhll", // 0x1D4
+    "8-bit Load to hhll", // 0x1D5
+    "8-bit Load to hhll", // 0x1D6
+    "8-bit Load to hhll", // 0x1D7
+    "MLT", // 0x1D8
+    "DIV", // 0x1D9
+    nullptr, // 0x1DA
+    nullptr, // 0x1DB
+    nullptr, // 0x1DC
+    nullptr, // 0x1DD
+    nullptr, // 0x1DE
+    nullptr, // 0x1DF
+    "JRS C rr", // 0x1E0
+    "JRS C rr", // 0x1E1
+    "JRS C rr", // 0x1E2
+    "JRS C rr", // 0x1E3
+    "JRS C rr", // 0x1E4
+    "JRS C rr", // 0x1E5
+    "JRS C rr", // 0x1E6
+    "JRS C rr", // 0x1E7
+    "JRS C rr", // 0x1E8
+    "JRS C rr", // 0x1E9
+    "JRS C rr", // 0x1EA
+    "JRS C rr", // 0x1EB
+    "JRS C rr", // 0x1EC
+    "JRS C rr", // 0x1ED
+    "JRS C rr", // 0x1EE
+    "JRS C rr", // 0x1EF
+    "CARS rr", // 0x1F0
+    "CARS rr", // 0x1F1
+    "CARS rr", // 0x1F2
+    "CARS rr", // 0x1F3
+    "CARS rr", // 0x1F4
+    "CARS rr", // 0x1F5
+    "CARS rr", // 0x1F6
+    "CARS rr", // 0x1F7
+    "CARS rr", // 0x1F8
+    "CARS rr", // 0x1F9
+    "CARS rr", // 0x1FA
+    "CARS rr", // 0x1FB
+    "CARS rr", // 0x1FC
+    "CARS rr", // 0x1FD
+    "CARS rr", // 0x1FE
+    "CARS rr", // 0x1FF
+    "16-bit ADD", // 0x200
+    "16-bit ADD", // 0x201
+    "16-bit ADD", // 0x202
+    "16-bit ADD", // 0x203
+    "16-bit ADC", // 0x204
+    "16-bit ADC", // 0x205
+    "16-bit ADC", // 0x206
+    "16-bit ADC", // 0x207
+    "16-bit SUB", // 0x208
+    "16-bit SUB", // 0x209
+    "16-bit SUB", // 0x20A
+    "16-bit SUB", // 0x20B
+    "16-bit SBC", // 0x20C
+    "16-bit SBC", // 0x20D
+    "16-bit SBC", // 0x20E
+    "16-bit SBC", // 0x20F
+    nullptr, // 0x210
+    nullptr, // 0x211
+    nullptr, // 0x212
+    nullptr, // 0x213
+    nullptr, // 0x214
+    nullptr, // 0x215
+    nullptr, // 0x216
+    nullptr, // 0x217
+    "16-bit CMP", // 0x218
+    "16-bit CMP", // 0x219
+    "16-bit CMP", // 0x21A
+    "16-bit CMP", // 0x21B
+    nullptr, // 0x21C
+    nullptr, // 0x21D
+    nullptr, // 0x21E
+    nullptr, // 0x21F
+    "16-bit ADD", // 0x220
+    "16-bit ADD", // 0x221
+    "16-bit ADD", // 0x222
+    "16-bit ADD", // 0x223
+    "16-bit ADC", // 0x224
+    "16-bit ADC", // 0x225
+    "16-bit ADC", // 0x226
+    "16-bit ADC", // 0x227
+    "16-bit SUB", // 0x228
+    "16-bit SUB", // 0x229
+    "16-bit SUB", // 0x22A
+    "16-bit SUB", // 0x22B
+    "16-bit SBC", // 0x22C
+    "16-bit SBC", // 0x22D
+    "16-bit SBC", // 0x22E
+    "16-bit SBC", // 0x22F
+    nullptr, // 0x230
+    nullptr, // 0x231
+    nullptr, // 0x232
+    nullptr, // 0x233
+    nullptr, // 0x234
+    nullptr, // 0x235
+    nullptr, // 0x236
+    nullptr, // 0x237
+    "16-bit CMP", // 0x238
+    "16-bit CMP", // 0x239
+    "16-bit CMP", // 0x23A
+    "16-bit CMP", // 0x23B
+    nullptr, // 0x23C
+    nullptr, // 0x23D
+    nullptr, // 0x23E
+    nullptr, // 0x23F
+    "16-bit ADD", // 0x240
+    "16-bit ADD", // 0x241
+    "16-bit ADD", // 0x242
+    "16-bit ADD", // 0x243
+    "16-bit ADD", // 0x244
+    "16-bit ADD", // 0x245
+    nullptr, // 0x246
+    nullptr, // 0x247
+    "16-bit SUB", // 0x248
+    "16-bit SUB", // 0x249
+    "16-bit SUB", // 0x24A
+    "16-bit SUB", // 0x24B
+    "16-bit SUB", // 0x24C
+    "16-bit SUB", // 0x24D
+    nullptr, // 0x24E
+    nullptr, // 0x24F
+    nullptr, // 0x250
+    nullptr, // 0x251
+    nullptr, // 0x252
+    nullptr, // 0x253
+    nullptr, // 0x254
+    nullptr, // 0x255
+    nullptr, // 0x256
+    nullptr, // 0x257
+    nullptr, // 0x258
+    nullptr, // 0x259
+    nullptr, // 0x25A
+    nullptr, // 0x25B
+    "16-bit CMP", // 0x25C
+    "16-bit CMP", // 0x25D
+    nullptr, // 0x25E
+    nullptr, // 0x25F
+    "16-bit ADC", // 0x260
+    "16-bit ADC", // 0x261
+    "16-bit SBC", // 0x262
+    "16-bit SBC", // 0x263
+    nullptr, // 0x264
+    nullptr, // 0x265
+    nullptr, // 0x266
+    nullptr, // 0x267
+    "16-bit ADD", // 0x268
+    nullptr, // 0x269
+    "16-bit SUB", // 0x26A
+    nullptr, // 0x26B
+    "16-bit CMP", // 0x26C
+    nullptr, // 0x26D
+    "16-bit Load to SP", // 0x26E
+    nullptr, // 0x26F
+    "#CFF9", // 0x270
+    "#CFF5", // 0x271
+    "16-bit Load to IX", // 0x272
+    "16-bit Load to IY", // 0x273
+    "16-bit load to SP+dd", // 0x274
+    "16-bit load to SP+dd", // 0x275
+    "16-bit load to SP+dd", // 0x276
+    "16-bit load to SP+dd", // 0x277
+    "16-bit Load to SP", // 0x278
+    nullptr, // 0x279
+    nullptr, // 0x27A
+    nullptr, // 0x27B
+    "16-bit Load to hhll", // 0x27C
+    nullptr, // 0x27D
+    nullptr, // 0x27E
+    nullptr, // 0x27F
+    nullptr, // 0x280
+    nullptr, // 0x281
+    nullptr, // 0x282
+    nullptr, // 0x283
+    nullptr, // 0x284
+    nullptr, // 0x285
+    nullptr, // 0x286
+    nullptr, // 0x287
+    nullptr, // 0x288
+    nullptr, // 0x289
+    nullptr, // 0x28A
+    nullptr, // 0x28B
+    nullptr, // 0x28C
+    nullptr, // 0x28D
+    nullptr, // 0x28E
+    nullptr, // 0x28F
+    nullptr, // 0x290
+    nullptr, // 0x291
+    nullptr, // 0x292
+    nullptr, // 0x293
+    nullptr, // 0x294
+    nullptr, // 0x295
+    nullptr, // 0x296
+    nullptr, // 0x297
+    nullptr, // 0x298
+    nullptr, // 0x299
+    nullptr, // 0x29A
+    nullptr, // 0x29B
+    nullptr, // 0x29C
+    nullptr, // 0x29D
+    nullptr, // 0x29E
+    nullptr, // 0x29F
+    nullptr, // 0x2A0
+    nullptr, // 0x2A1
+    nullptr, // 0x2A2
+    nullptr, // 0x2A3
+    nullptr, // 0x2A4
+    nullptr, // 0x2A5
+    nullptr, // 0x2A6
+    nullptr, // 0x2A7
+    nullptr, // 0x2A8
+    nullptr, // 0x2A9
+    nullptr, // 0x2AA
+    nullptr, // 0x2AB
+    nullptr, // 0x2AC
+    nullptr, // 0x2AD
+    nullptr, // 0x2AE
+    nullptr, // 0x2AF
+    "PUSH", // 0x2B0
+    "PUSH", // 0x2B1
+    "PUSH", // 0x2B2
+    "PUSH", // 0x2B3
+    "POP", // 0x2B4
+    "POP", // 0x2B5
+    "POP", // 0x2B6
+    "POP", // 0x2B7
+    "PUSH ALL", // 0x2B8
+    "PUSH ALE", // 0x2B9
+    nullptr, // 0x2BA
+    nullptr, // 0x2BB
+    "POP ALL", // 0x2BC
+    "POP ALE", // 0x2BD
+    nullptr, // 0x2BE
+    nullptr, // 0x2BF
+    "#CFF9", // 0x2C0
+    "#CFF5", // 0x2C1
+    "16-bit Load to IX", // 0x2C2
+    "16-bit Load to IY", // 0x2C3
+    "16-bit Load to HL", // 0x2C4
+    "16-bit Load to HL", // 0x2C5
+    "16-bit Load to HL", // 0x2C6
+    "16-bit Load to HL", // 0x2C7
+    nullptr, // 0x2C8
+    nullptr, // 0x2C9
+    nullptr, // 0x2CA
+    nullptr, // 0x2CB
+    nullptr, // 0x2CC
+    nullptr, // 0x2CD
+    nullptr, // 0x2CE
+    nullptr, // 0x2CF
+    "#CFF9", // 0x2D0
+    "#CFF5", // 0x2D1
+    "16-bit Load to IX", // 0x2D2
+    "16-bit Load to IY", // 0x2D3
+    "16-bit Load to IX", // 0x2D4
+    "16-bit Load to IX", // 0x2D5
+    "16-bit Load to IX", // 0x2D6
+    "16-bit Load to IX", // 0x2D7
+    "#CFF9", // 0x2D8
+    "#CFF5", // 0x2D9
+    "16-bit Load to IX", // 0x2DA
+    "16-bit Load to IY", // 0x2DB
+    "16-bit Load to IY", // 0x2DC
+    "16-bit Load to IY", // 0x2DD
+    "16-bit Load to IY", // 0x2DE
+    "16-bit Load to IY", // 0x2DF
+    "16-bit Load to BA", // 0x2E0
+    "16-bit Load to BA", // 0x2E1
+    "16-bit Load to BA", // 0x2E2
+    "16-bit Load to BA", // 0x2E3
+    "16-bit Load to HL", // 0x2E4
+    "16-bit Load to HL", // 0x2E5
+    "16-bit Load to HL", // 0x2E6
+    "16-bit Load to HL", // 0x2E7
+    "16-bit Load to IX", // 0x2E8
+    "16-bit Load to IX", // 0x2E9
+    "16-bit Load to IX", // 0x2EA
+    "16-bit Load to IX", // 0x2EB
+    "16-bit Load to IY", // 0x2EC
+    "16-bit Load to IY", // 0x2ED
+    "16-bit Load to IY", // 0x2EE
+    "16-bit Load to IY", // 0x2EF
+    "16-bit Load to SP", // 0x2F0
+    "16-bit Load to SP", // 0x2F1
+    "16-bit Load to SP", // 0x2F2
+    "16-bit Load to SP", // 0x2F3
+    "16-bit Load to HL", // 0x2F4
+    nullptr, // 0x2F5
+    nullptr, // 0x2F6
+    nullptr, // 0x2F7
+    "16-bit Load to BA", // 0x2F8
+    nullptr, // 0x2F9
+    "16-bit Load to IX", // 0x2FA
+    nullptr, // 0x2FB
+    nullptr, // 0x2FC
+    nullptr, // 0x2FD
+    "16-bit Load to IY", // 0x2FE
+    nullptr, // 0x2FF
+};
@@ -0,0 +1,385 @@
+#include "sim.h"
+#include "sim_batch.h"
+#include "sim_state.h"
+
+#include <chrono>
+#include <vector>
+#include <algorithm>
+#include <map>
+#include <string>
+
+// Cycles between the points where -k inputs are applied and -H frames are
+// hashed.
+#define SIM_BENCH_BATCH_CYCLES 4000
+
+// 2000-01-01 00:00:00 UTC.
+#define SIM_BENCH_START_TIME 946684800
+
+// Headless throughput benchmark. Runs each cartridge for a fixed number of
+// emulated frames, without rendering, audio or tracing, and reports how fast
+// the model simulates.
+//
+// Usage: minx_bench [-f num_frames] [-v] [-R cycles] [-L prefix]
+//                   [-B prefix] [-P prefix] [-C dir] [-M movie]
+//                   [-T seconds] [-F] [-k frame:keys] [-H frame]
+//                   [-t threads] [-q cycles] rom.min [rom.min ...]
+//
+// By default the per-cycle diagnostics are compiled out (ChecksNone); -v
+// runs with ChecksValidate instead to measure their cost. -R also keeps the
+// given number of cycles in the flight recorder and writes them to
+// flight_<n>_000.vcd, n being the index of the rom, when a check fails; it
+// implies -v. -L writes the retire log of each rom (see retire_log.h) to
+// <prefix>_<n>.rlog, or <prefix>_<n>.rlog.lz4 with SIM_HAVE_LZ4; it also
+// implies -v. -B writes the bus log of each rom (see bus_log.h) to
+// <prefix>_<n>.bus, -P the frame log (see frame_log.h) to <prefix>_<n>.frames.
+// Logs of two builds are compared with sim_diff. -C starts each rom from the
+// end of the bios boot, taken from or added to the boot cache in the given
+// directory (see sim_state.h); the boot is left out of the results. -M
+// replays the inputs of a movie (see movie.h) on every rom it was recorded
+// with, so every build runs the exact same workload. -F enables HALT
+// fast-forward, the skipped column shows the share of cycles it skipped.
+//
+// -k sets keys_active to the given mask once the given frame is reached,
+// e.g. -k 120:0x01 -k 124:0 taps A. The mask is applied at the first
+// multiple of SIM_BENCH_BATCH_CYCLES cycles from reset after the frame
+// starts, so it lands on the same cycle with or without -C or -q. -H
+// prints a hash of the given frame as "hash <rom> <frame> <hash>". Both
+// can be repeated; they are used by scripts/run_regression.py.
+//
+// -T sets the wall clock time the machines start at, in seconds since the
+// epoch and in UTC; the bios sets the eeprom clock from it (see
+// sim_load_eeprom()), so roms that read the clock give the same frames in
+// every run. It defaults to SIM_BENCH_START_TIME, and a replayed movie
+// brings its own.
+//
+// -t runs the roms on that many threads through sim_batch.h, one machine
+// per rom, all sharing the loaded images; -q sets the number of cycles a
+// machine runs before its thread picks the next job. The total line then
+// reports the wall time of the whole batch, so emu_MHz is the combined
+// throughput.
+
+struct KeyEvent
+{
+    uint32_t frame;
+    uint16_t keys;
+};
+
+struct BenchOptions
+{
+    uint32_t num_frames;
+    uint32_t flight_cycles;
+    const char* retire_log_prefix;
+    const char* bus_log_prefix;
+    const char* frame_log_prefix;
+    const char* boot_cache;
+    const char* movie;
+    int64_t start_time;
+    bool fast_forward;
+    std::vector<KeyEvent> key_events;
+    std::vector<uint32_t> hash_frames;
+};
+
+struct BenchResult
+{
+    uint32_t frames;
+    uint64_t cycles;
+    uint64_t evals;
+    uint64_t cycles_skipped;
+    double   seconds;
+    std::vector<uint64_t> hashes;
+};
+
+struct BenchJob
+{
+    SimBatchJob batch_job;
+    const SimImage* bios;
+    const SimImage* cartridge;
+    const BenchOptions* options;
+
+    SimData sim;
+    int index;
+    uint64_t boot_cycles;
+    bool started;
+    size_t next_key_event;
+    size_t next_hash_frame;
+
+    BenchResult result;
+};
+
+// Runs a rom for up to num_cycles cycles, returns true once it has run for
+// the requested number of frames.
+template<typename Checks>
+bool bench_run(SimBatchJob* batch_job, uint32_t num_cycles)
+{
+    BenchJob* job = (BenchJob*) batch_job->user;
+    SimData* sim = &job->sim;
+    const BenchOptions* options = job->options;
+
+    if(!job->started)
+    {
+        sim_init_shared(sim, job->bios, job->cartridge);
+        sim_set_start_time(sim, options->start_time);
+        sim->fast_forward = options->fast_forward;
+        if(options->flight_cycles > 0)
+        {
+            char filepath[32];
+            snprintf(filepath, sizeof(filepath), "flight_%d", job->index);
+            sim_enable_flight_recorder(sim, options->flight_cycles, options->flight_cycles / 16, filepath);
+        }
+        if(options->retire_log_prefix)
+        {
+            char filepath[256];
+            snprintf(filepath, sizeof(filepath), SIM_HAVE_LZ4? "%s_%d.rlog.lz4": "%s_%d.rlog", options->retire_log_prefix, job->index);
+            sim_enable_retire_log(sim, filepath);
+        }
+        if(options->bus_log_prefix)
+        {
+            char filepath[256];
+            snprintf(filepath, sizeof(filepath), "%s_%d.bus", options->bus_log_prefix, job->index);
+            sim_enable_bus_log(sim, filepath);
+        }
+        if(options->frame_log_prefix)
+        {
+            char filepath[256];
+            snprintf(filepath, sizeof(filepath), "%s_%d.frames", options->frame_log_prefix, job->index);
+            sim_enable_frame_log(sim, filepath);
+        }
+        job->boot_cycles = 0;
+        if(options->boot_cache && sim_boot_cached<Checks>(sim, options->boot_cache))
+        {
+            job->boot_cycles    = sim->timestamp / 2;
+            sim->num_evals      = 0;
+            sim->cycles_skipped = 0;
+
+            // Inputs and hashes of frames shown during the boot can't be
+            // honored any more.
+            bool late = (options->key_events.size() > 0 && options->key_events[0].frame < sim->frame_count) ||
+                        (options->hash_frames.size() > 0 && options->hash_frames[0] + 8 <= sim->frame_count);
+            if(late)
+                PRINTE("Boot ends at frame %u, after the first input or hashed frame.\n", sim->frame_count);
+        }
+        if(options->movie)
+            sim_replay_movie(sim, options->movie);
+
+        job->started = true;
+        job->next_key_event  = 0;
+        job->next_hash_frame = 0;
+        job->result = BenchResult();
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    uint64_t end_timestamp = sim->timestamp + 2 * (uint64_t)num_cycles;
+    while(sim->timestamp < end_timestamp && sim->frame_count < options->num_frames && !sim->context->gotFinish())
+    {
+        // Inputs and hashes are handled between batches of steps; a batch
+        // is shorter than a frame, so nothing is missed. The batches end on
+        // multiples of SIM_BENCH_BATCH_CYCLES from reset rather than from
+        // where the run started (the end of a cached boot, a quantum), so
+        // inputs land on the same cycles whichever way the run got there.
+        while(job->next_key_event < options->key_events.size() && options->key_events[job->next_key_event].frame <= sim->frame_count)
+            sim->minx->keys_active = options->key_events[job->next_key_event++].keys;
+
+        simulate_steps<Checks>(sim, SIM_BENCH_BATCH_CYCLES - (sim->timestamp / 2) % SIM_BENCH_BATCH_CYCLES);
+
+        while(job->next_hash_frame < options->hash_frames.size() && options->hash_frames[job->next_hash_frame] <= sim->frame_count)
+        {
+            const uint8_t* framebuffer = sim_get_frame(sim, options->hash_frames[job->next_hash_frame++]);
+            job->result.hashes.push_back(framebuffer? sim_hash_frame(framebuffer): 0);
+        }
+    }
+    bool finished = sim->frame_count >= options->num_frames || sim->context->gotFinish();
+    auto end = std::chrono::steady_clock::now();
+
+    job->result.seconds += std::chrono::duration<double>(end - start).count();
+
+    if(finished)
+    {
+        job->result.frames  = sim->frame_count;
+        job->result.cycles  = sim->timestamp / 2 - job->boot_cycles;
+        job->result.evals   = sim->num_evals;
+        job->result.cycles_skipped = sim->cycles_skipped;
+        sim_destroy(sim);
+    }
+
+    return finished;
+}
+
+void print_result(const char* name, const BenchResult* result)
+{
+    printf("%-40s %8u %12llu %9.3f %9.3f %12.0f %10.3f %7.1f%%\n",
+        name,
+        result->frames,
+        (unsigned long long)result->cycles,
+        result->seconds,
+        result->cycles / result->seconds / 1e6,
+        result->evals / result->seconds,
+        1000.0 * result->seconds / (result->frames? result->frames: 1),
+        100.0 * result->cycles_skipped / (result->cycles? result->cycles: 1));
+}
+
+int main(int argc, char** argv)
+{
+    BenchOptions options;
+    options.num_frames = 600;
+    options.flight_cycles = 0;
+    options.retire_log_prefix = nullptr;
+    options.bus_log_prefix = nullptr;
+    options.frame_log_prefix = nullptr;
+    options.boot_cache = nullptr;
+    options.movie = nullptr;
+    options.start_time = SIM_BENCH_START_TIME;
+    options.fast_forward = false;
+    bool validate = false;
+    int num_threads = 1;
+    uint32_t quantum_cycles = 400000;
+
+    int arg = 1;
+    for(; arg < argc && argv[arg][0] == '-'; ++arg)
+    {
+        if(strcmp(argv[arg], "-f") == 0 && arg + 1 < argc)
+            options.num_frames = atoi(argv[++arg]);
+        else if(strcmp(argv[arg], "-v") == 0)
+            validate = true;
+        else if(strcmp(argv[arg], "-R") == 0 && arg + 1 < argc)
+        {
+            options.flight_cycles = strtoul(argv[++arg], nullptr, 0);
+            validate = true;
+        }
+        else if(strcmp(argv[arg], "-L") == 0 && arg + 1 < argc)
+        {
+            options.retire_log_prefix = argv[++arg];
+            validate = true;
+        }
+        else if(strcmp(argv[arg], "-B") == 0 && arg + 1 < argc)
+            options.bus_log_prefix = argv[++arg];
+        else if(strcmp(argv[arg], "-P") == 0 && arg + 1 < argc)
+            options.frame_log_prefix = argv[++arg];
+        else if(strcmp(argv[arg], "-C") == 0 && arg + 1 < argc)
+            options.boot_cache = argv[++arg];
+        else if(strcmp(argv[arg], "-M") == 0 && arg + 1 < argc)
+            options.movie = argv[++arg];
+        else if(strcmp(argv[arg], "-T") == 0 && arg + 1 < argc)
+            options.start_time = strtoll(argv[++arg], nullptr, 0);
+        else if(strcmp(argv[arg], "-F") == 0)
+            options.fast_forward = true;
+        else if(strcmp(argv[arg], "-k") == 0 && arg + 1 < argc)
+        {
+            KeyEvent event;
+            char* separator;
+            event.frame = strtoul(argv[++arg], &separator, 0);
+            if(*separator != ':')
+            {
+                fprintf(stderr, "Invalid key event %s, expected frame:keys.\n", argv[arg]);
+                return -1;
+            }
+            event.keys = strtoul(separator + 1, nullptr, 0) & 0x1FF;
+            options.key_events.push_back(event);
+        }
+        else if(strcmp(argv[arg], "-H") == 0 && arg + 1 < argc)
+            options.hash_frames.push_back(strtoul(argv[++arg], nullptr, 0));
+        else if(strcmp(argv[arg], "-t") == 0 && arg + 1 < argc)
+            num_threads = atoi(argv[++arg]);
+        else if(strcmp(argv[arg], "-q") == 0 && arg + 1 < argc)
+            quantum_cycles = strtoul(argv[++arg], nullptr, 0);
+        else
+        {
+            fprintf(stderr, "Unknown option %s.\n", argv[arg]);
+            return -1;
+        }
+    }
+
+    if(arg == argc)
+    {
+        fprintf(stderr, "Usage: %s [-f num_frames] [-v] [-R cycles] [-L prefix] [-B prefix] [-P prefix] [-C dir] [-M movie] [-T seconds] [-F] [-k frame:keys] [-H frame] [-t threads] [-q cycles] rom.min [rom.min ...]\n", argv[0]);
+        return -1;
+    }
+
+    // The eeprom clock is set from the local time, pin it to UTC so it
+    // doesn't depend on the host.
+    setenv("TZ", "UTC0", 1);
+    tzset();
+
+    std::stable_sort(options.key_events.begin(), options.key_events.end(),
+        [](const KeyEvent& a, const KeyEvent& b){ return a.frame < b.frame; });
+    std::sort(options.hash_frames.begin(), options.hash_frames.end());
+
+    SimImage bios;
+    if(!sim_load_bios(&bios, "data/bios.min"))
+        return -1;
+
+    // Each cartridge is loaded once, even if it is listed several times.
+    std::map<std::string, SimImage> cartridges;
+    std::vector<const char*> names;
+    std::vector<const SimImage*> jobs;
+    for(; arg < argc; ++arg)
+    {
+        auto it = cartridges.find(argv[arg]);
+        if(it == cartridges.end())
+        {
+            SimImage cartridge;
+            if(!sim_load_cartridge(&cartridge, argv[arg]))
+                continue;
+            it = cartridges.insert({argv[arg], cartridge}).first;
+        }
+        names.push_back(argv[arg]);
+        jobs.push_back(&it->second);
+    }
+
+    std::vector<BenchJob> bench_jobs(jobs.size());
+    std::vector<SimBatchJob*> batch_jobs;
+    for(size_t i = 0; i < jobs.size(); ++i)
+    {
+        BenchJob* job = &bench_jobs[i];
+        job->batch_job.run  = validate? bench_run<ChecksValidate>: bench_run<ChecksNone>;
+        job->batch_job.user = job;
+        job->bios      = &bios;
+        job->cartridge = jobs[i];
+        job->options   = &options;
+        job->index     = i;
+        job->started   = false;
+        batch_jobs.push_back(&job->batch_job);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    if(num_threads > 1)
+    {
+        SimBatchStats stats = sim_batch_run(batch_jobs.data(), batch_jobs.size(), num_threads, quantum_cycles);
+        printf("%llu quanta, %llu steals.\n", (unsigned long long)stats.quanta, (unsigned long long)stats.steals);
+    }
+    else
+    {
+        for(SimBatchJob* job: batch_jobs)
+            while(!job->run(job, quantum_cycles));
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    printf("%-40s %8s %12s %9s %9s %12s %10s %8s\n", "rom", "frames", "cycles", "wall_s", "emu_MHz", "evals/s", "ms/frame", "skipped");
+
+    BenchResult total = {};
+    for(size_t i = 0; i < jobs.size(); ++i)
+    {
+        const BenchResult& result = bench_jobs[i].result;
+        for(size_t h = 0; h < result.hashes.size(); ++h)
+            printf("hash %s %u 0x%016llx\n", names[i], options.hash_frames[h], (unsigned long long)result.hashes[h]);
+
+        print_result(names[i], &result);
+
+        total.frames  += result.frames;
+        total.cycles  += result.cycles;
+        total.evals   += result.evals;
+        total.cycles_skipped += result.cycles_skipped;
+        total.seconds += result.seconds;
+    }
+
+    if(num_threads > 1)
+        total.seconds = std::chrono::duration<double>(end - start).count();
+
+    if(total.seconds > 0.0)
+        print_result("total", &total);
+
+    for(auto& it: cartridges)
+        sim_free_image(&it.second);
+    sim_free_image(&bios);
+
+    return 0;
+}
@@ -0,0 +1,185 @@
+#include "sim.h"
+#include "sim_state.h"
+#include "sim_fork.h"
+
+#include <chrono>
+#include <vector>
+#include <algorithm>
+
+// Explores the inputs of a game from one state with sim_fork.h: runs the
+// rom to a frame, then forks one branch per key mask, holds the keys for a
+// number of frames and reports where each branch ended up. Branches that
+// end on the same frame are grouped, so the inputs that make a difference
+// stand out.
+//
+// Usage: minx_explore [-f frame] [-n num_frames] [-j jobs] [-k keys ...]
+//                     [-load-state file] [-C dir] rom.min
+//
+// -f is the frame to branch from (600 by default), -n how many frames each
+// branch runs for (60 by default) and -j how many branches run at once.
+// -k adds a key mask to try, see keys_active; by default all 128
+// combinations of the direction and A, B, C keys are tried. -load-state
+// branches from a save state and -C from the end of the bios boot, see
+// sim_state.h.
+
+struct ExploreResult
+{
+    uint64_t hash;
+    uint64_t cycle;
+    uint32_t frame;
+    uint32_t pc;
+};
+
+struct ExploreBranch
+{
+    uint16_t keys;
+    SimBranch branch;
+    ExploreResult result;
+    bool ok;
+};
+
+bool explore_run_to_frame(SimData* sim, uint32_t frame)
+{
+    while(sim->frame_count < frame && !sim->context->gotFinish())
+        simulate_steps<ChecksNone>(sim, 4000);
+    return sim->frame_count >= frame;
+}
+
+bool explore_start(SimData* sim, ExploreBranch* branch, uint32_t num_frames)
+{
+    int side = sim_fork(sim, &branch->branch);
+    if(side < 0)
+        return false;
+    if(side > 0)
+        return true;
+
+    sim->minx->keys_active = branch->keys;
+    explore_run_to_frame(sim, sim->frame_count + num_frames);
+
+    const uint8_t* framebuffer = sim_get_frame(sim, sim->frame_count);
+    ExploreResult result;
+    result.hash  = framebuffer? sim_hash_frame(framebuffer): 0;
+    result.cycle = sim->timestamp / 2;
+    result.frame = sim->frame_count;
+    result.pc    = sim->minx->rootp->minx__DOT__cpu__DOT__PC;
+    sim_branch_exit(&branch->branch, &result, sizeof(result));
+    return false;
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t start_frame = 600;
+    uint32_t num_frames  = 60;
+    int num_jobs = 8;
+    std::vector<uint16_t> key_masks;
+    const char* load_state = nullptr;
+    const char* boot_cache = nullptr;
+
+    int arg = 1;
+    for(; arg < argc && argv[arg][0] == '-'; ++arg)
+    {
+        if(strcmp(argv[arg], "-f") == 0 && arg + 1 < argc)
+            start_frame = strtoul(argv[++arg], nullptr, 0);
+        else if(strcmp(argv[arg], "-n") == 0 && arg + 1 < argc)
+            num_frames = strtoul(argv[++arg], nullptr, 0);
+        else if(strcmp(argv[arg], "-j") == 0 && arg + 1 < argc)
+            num_jobs = atoi(argv[++arg]);
+        else if(strcmp(argv[arg], "-k") == 0 && arg + 1 < argc)
+            key_masks.push_back(strtoul(argv[++arg], nullptr, 0));
+        else if(strcmp(argv[arg], "-load-state") == 0 && arg + 1 < argc)
+            load_state = argv[++arg];
+        else if(strcmp(argv[arg], "-C") == 0 && arg + 1 < argc)
+            boot_cache = argv[++arg];
+        else
+        {
+            fprintf(stderr, "Unknown option %s.\n", argv[arg]);
+            return -1;
+        }
+    }
+
+    if(arg + 1 != argc)
+    {
+        fprintf(stderr, "Usage: %s [-f frame] [-n num_frames] [-j jobs] [-k keys ...] [-load-state file] [-C dir] rom.min\n", argv[0]);
+        return -1;
+    }
+    if(num_jobs < 1) num_jobs = 1;
+    if(key_masks.empty())
+    {
+        for(uint16_t keys = 0; keys < 0x80; ++keys)
+            key_masks.push_back(keys);
+    }
+
+    SimData sim;
+    if(!sim_init(&sim, argv[arg]))
+        return -1;
+    if(load_state)
+    {
+        if(!sim_load_state(&sim, load_state))
+            return -1;
+    }
+    else if(boot_cache)
+        sim_boot_cached<ChecksNone>(&sim, boot_cache);
+
+    if(!explore_run_to_frame(&sim, start_frame))
+    {
+        fprintf(stderr, "The simulation finished before frame %u.\n", start_frame);
+        return -1;
+    }
+    printf("Branching at frame %u, cycle %llu.\n", sim.frame_count, (unsigned long long)(sim.timestamp / 2));
+
+    // Up to num_jobs branches run at once, joined in the order they were
+    // started.
+    auto start = std::chrono::steady_clock::now();
+    std::vector<ExploreBranch> branches(key_masks.size());
+    size_t num_started = 0;
+    size_t num_joined  = 0;
+    while(num_joined < branches.size())
+    {
+        while(num_started < branches.size() && num_started - num_joined < (size_t)num_jobs)
+        {
+            ExploreBranch* branch = &branches[num_started++];
+            branch->keys = key_masks[num_started - 1];
+            branch->ok   = false;
+            if(!explore_start(&sim, branch, num_frames))
+            {
+                sim_destroy(&sim);
+                return -1;
+            }
+        }
+
+        ExploreBranch* branch = &branches[num_joined++];
+        branch->ok = sim_branch_join(&branch->branch, &branch->result, sizeof(branch->result));
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    // Group the branches by the frame they ended on.
+    std::vector<ExploreBranch*> sorted;
+    for(ExploreBranch& branch: branches)
+    {
+        if(branch.ok)
+            sorted.push_back(&branch);
+        else
+            printf("keys 0x%03X: branch failed\n", branch.keys);
+    }
+    std::stable_sort(sorted.begin(), sorted.end(), [](const ExploreBranch* a, const ExploreBranch* b){ return a->result.hash < b->result.hash; });
+
+    size_t num_outcomes = 0;
+    for(size_t i = 0; i < sorted.size(); ++i)
+    {
+        const ExploreResult* result = &sorted[i]->result;
+        if(i == 0 || result->hash != sorted[i - 1]->result.hash)
+        {
+            ++num_outcomes;
+            printf("frame hash 0x%016llx, pc 0x%04X at frame %u:", (unsigned long long)result->hash, result->pc, result->frame);
+        }
+        printf(" 0x%03X", sorted[i]->keys);
+        if(i + 1 == sorted.size() || sorted[i + 1]->result.hash != result->hash)
+            printf("\n");
+    }
+
+    double seconds = std::chrono::duration<double>(end - start).count();
+    printf("%zu branches, %zu outcomes, %.3f s, %.1f branches/s.\n", branches.size(), num_outcomes, seconds, branches.size() / seconds);
+
+    sim_destroy(&sim);
+    return 0;
+}
@@ -1,50 +1,16 @@
-#include "Vminx.h"
-#include "Vminx___024root.h"
-#include "verilated.h"
-#include "verilated_vcd_c.h"
-#include <cstdio>
-#include <cstring>
-#include <cstdint>
-
-#include "instruction_cycles.h"
+#include "sim.h"
+#include "sim_rewind.h"
 
 #include <SDL2/SDL.h>
 #include <GL/glew.h>
 #include <SDL2/SDL_opengl.h>
 #include "gl_utils.h"
 
-#define VERBOSE 1
-
-#if VERBOSE == 0
-#define PRINTE(...) do{ } while ( false )
-#define PRINTD(...) do{ } while ( false )
-#elif VERBOSE == 1
-#define PRINTE(...) do{ fprintf( stderr, __VA_ARGS__ ); } while( false )
-#define PRINTD(...) do{ } while ( false )
-#else
-#define PRINTE(...) do{ fprintf( stderr, __VA_ARGS__ ); } while( false )
-#define PRINTD(...) do{ fprintf( stdout, __VA_ARGS__ ); } while( false )
-#endif
-
-
 int min(int a, int b)
 {
     return a < b? a: b;
 }
 
-enum
-{
-    BUS_IDLE      = 0x0,
-    BUS_IRQ_READ  = 0x1,
-    BUS_MEM_WRITE = 0x2,
-    BUS_MEM_READ  = 0x3
-};
-
-bool data_sent = false;
-bool irq_processing = false;
-int irq_copy_complete_old = 0;
-int num_cycles_since_sync = 0;
-int reset_counter = 0;
 
 bool gl_renderer_init(int buffer_width, int buffer_height)
 {
@@ -172,419 +138,6 @@ void gl_renderer_draw(int buffer_width, int buffer_height, void* buffer_data)
     glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
 }
 
-struct SimData
-{
-    Vminx* minx;
-    VerilatedVcdC* tfp;
-
-    uint64_t timestamp;
-    uint64_t osc1_clocks;
-    uint64_t osc1_next_clock;
-
-    uint8_t* bios;
-    uint8_t* memory;
-    uint8_t* cartridge;
-
-    size_t bios_file_size;
-    size_t cartridge_file_size;
-
-    uint8_t* bios_touched;
-    uint8_t* cartridge_touched;
-    uint8_t* instructions_executed;
-
-    uint8_t fb_write_index;
-    uint8_t framebuffers[768*8];
-};
-
-struct AudioBuffer
-{
-    uint8_t* data;
-    size_t size;
-    size_t read_position;
-};
-
-void sim_init(SimData* sim, const char* cartridge_path)
-{
-    FILE* fp = fopen("data/bios.min", "rb");
-    fseek(fp, 0, SEEK_END);
-    sim->bios_file_size = ftell(fp);
-    fseek(fp, 0, SEEK_SET);  /* same as rewind(f); */
-
-    sim->bios = (uint8_t*) malloc(sim->bios_file_size);
-    fread(sim->bios, 1, sim->bios_file_size, fp);
-    fclose(fp);
-
-    sim->bios_touched = (uint8_t*) calloc(sim->bios_file_size, 1);
-
-    sim->memory = (uint8_t*) calloc(1, 4*1024);
-
-    // Load a cartridge.
-    sim->cartridge = (uint8_t*) calloc(1, 0x200000);
-
-    fp = fopen(cartridge_path, "rb");
-    fseek(fp, 0, SEEK_END);
-    sim->cartridge_file_size = ftell(fp);
-    fseek(fp, 0, SEEK_SET);  /* same as rewind(f); */
-    fread(sim->cartridge, 1, sim->cartridge_file_size, fp);
-    fclose(fp);
-
-    sim->cartridge_touched = (uint8_t*) calloc(1, sim->cartridge_file_size);
-    sim->instructions_executed = (uint8_t*) calloc(1, 0x300);
-
-    sim->fb_write_index = 0;
-    memset(sim->framebuffers, 0x0, 8*768);
-
-    sim->minx = new Vminx;
-    sim->minx->clk = 0;
-    sim->minx->reset = 1;
-    sim->minx->clk_ce_4mhz = 1;
-    sim->minx->eeprom_we = 0;
-
-    sim->osc1_clocks = 4000000.0 / 32768.0 + 0.5;
-    sim->osc1_next_clock = sim->osc1_clocks;
-
-    sim->timestamp = 0;
-
-    Verilated::traceEverOn(true);
-    sim->tfp = nullptr;
-
-    sim->minx->clk_rt_ce = 1;
-}
-
-void sim_dump_stop(SimData* sim)
-{
-    if(!sim->tfp) return;
-    printf("Stopping dump.\n");
-
-    sim->tfp->close();
-    delete sim->tfp;
-    sim->tfp = nullptr;
-}
-
-void sim_dump_eeprom(SimData* sim, const char* filepath)
-{
-    VlUnpacked<unsigned char, 8192> rom = sim->minx->rootp->minx__DOT__eeprom__DOT__rom;
-    const uint8_t* data = rom.m_storage;
-    FILE* fp = fopen(filepath, "wb");
-    {
-        fwrite(data, 1, 8192, fp);
-    }
-    fclose(fp);
-}
-
-void sim_dump_start(SimData* sim, const char* filepath)
-{
-    printf("Starting dump at timestamp: %llu.\n", sim->timestamp);
-    if(sim->tfp)
-        sim_dump_stop(sim);
-
-    sim->tfp = new VerilatedVcdC;
-    sim->minx->trace(sim->tfp, 99);  // Trace 99 levels of hierarchy
-    //sim->tfp->rolloverMB(209715200);
-    sim->tfp->open(filepath);
-}
-
-void eeprom_set_timestamp(uint8_t* eeprom, uint8_t year, uint8_t month, uint8_t day, uint8_t hour, uint8_t min, uint8_t sec)
-{
-    if (!eeprom) return;
-    uint8_t checksum = year + month + day + hour + min + sec;
-    eeprom[0x1FF6] = 0x00;
-    eeprom[0x1FF7] = 0x00;
-    eeprom[0x1FF8] = 0x00;
-    eeprom[0x1FF9] = year;
-    eeprom[0x1FFA] = month;
-    eeprom[0x1FFB] = day;
-    eeprom[0x1FFC] = hour;
-    eeprom[0x1FFD] = min;
-    eeprom[0x1FFE] = sec;
-    eeprom[0x1FFF] = checksum;
-}
-
-void sim_load_eeprom(SimData* sim, const char* filepath)
-{
-    uint8_t* eeprom = sim->minx->rootp->minx__DOT__eeprom__DOT__rom.m_storage;
-    {
-        strncpy((char*)eeprom, "GBMN", 4);
-        eeprom[0x1FF2] = 0x01;
-        eeprom[0x1FF3] = 0x03;
-        eeprom[0x1FF4] = 0x01;
-        eeprom[0x1FF5] = 0x1F;
-        //FILE* fp = fopen(filepath, "rb");
-        //fread(eeprom, 1, 8192, fp);
-        //fclose(fp);
-    }
-    // @todo: Try initializing just a few required fields, like the GBMN and
-    // see if that's sufficient for accepting the set datetime.
-
-    time_t tim = time(NULL);
-    struct tm* now = localtime(&tim);
-    eeprom_set_timestamp(eeprom, now->tm_year % 100, now->tm_mon+1, now->tm_mday, now->tm_hour, now->tm_min, now->tm_sec);
-
-    // @note: The commented out part is not required; these already have these values.
-    //sim->minx->rootp->minx__DOT__rtc__DOT__timer = 0;
-    //sim->minx->rootp->minx__DOT__rtc__DOT__reg_enabled = 1;
-    sim->minx->rootp->minx__DOT__system_control__DOT__reg_system_control[2] |= 2;
-}
-
-void simulate_steps(SimData* sim, int n_steps, AudioBuffer* audio_buffer = nullptr)
-{
-    uint8_t frame_complete_latch = sim->minx->frame_complete;
-    for(int i = 0; i < n_steps && !Verilated::gotFinish(); ++i)
-    {
-        sim->minx->clk = 1;
-        sim->minx->eval();
-        if(sim->timestamp == sim->osc1_next_clock)
-        {
-            sim->minx->clk_rt = !sim->minx->clk_rt;
-            sim->minx->eval();
-            if(sim->tfp) sim->tfp->dump(sim->timestamp);
-            sim->osc1_next_clock += sim->osc1_clocks;
-        }
-        else if(sim->tfp) sim->tfp->dump(sim->timestamp);
-        sim->timestamp++;
-
-        sim->minx->clk = 0;
-        sim->minx->eval();
-        if(sim->timestamp == sim->osc1_next_clock)
-        {
-            sim->minx->clk_rt = !sim->minx->clk_rt;
-            sim->minx->eval();
-            if(sim->tfp) sim->tfp->dump(sim->timestamp);
-            sim->osc1_next_clock += sim->osc1_clocks;
-        }
-        else if(sim->tfp) sim->tfp->dump(sim->timestamp);
-        sim->timestamp++;
-
-        if(sim->minx->address_out == 0xAB)
-            sim_load_eeprom(sim, "eeprom000.bin");
-
-
-        if(audio_buffer)
-        {
-            uint8_t volume = sim->minx->sound_volume;
-            uint8_t sound_pulse = sim->minx->sound_pulse;
-            uint8_t multiplier = (volume == 0)? 0: ((volume == 3)? 255: 127);
-            //audio_buffer->data[i] = (2 * sound_pulse - 1) * multiplier;
-            audio_buffer->data[i] = sound_pulse * multiplier;
-            //if(audio_buffer->data[i] < 0) --audio_buffer->data[i];
-        }
-
-        if(sim->minx->frame_complete && !frame_complete_latch)
-        {
-            if(sim->minx->rootp->minx__DOT__lcd__DOT__display_enabled)
-            {
-                for (int yC=0; yC<8; yC++)
-                {
-                    for (int xC=0; xC<96; xC++)
-                    {
-                        uint8_t data = sim->minx->rootp->minx__DOT__lcd__DOT__all_pixels_on_enabled ?
-                            0xFF:
-                            sim->minx->rootp->minx__DOT__lcd__DOT__invert_pixels_enabled?
-                                sim->minx->rootp->minx__DOT__lcd__DOT__lcd_data[yC * 132 + xC] ^ 0xFF:
-                                sim->minx->rootp->minx__DOT__lcd__DOT__lcd_data[yC * 132 + xC];
-                        sim->framebuffers[768 * sim->fb_write_index + yC * 96 + xC] = data;
-                    }
-                }
-            }
-            else memset(sim->framebuffers + 768 * sim->fb_write_index, 0, 96*8);
-            sim->fb_write_index = (sim->fb_write_index + 1) % 8;
-        }
-        frame_complete_latch = sim->minx->frame_complete;
-
-        if(sim->minx->rootp->minx__DOT__irq_copy_complete && irq_copy_complete_old == 0)
-        {
-            irq_copy_complete_old = 1;
-            PRINTD("Copy complete %d.\n", sim->timestamp / 2);
-        }
-        else if(!sim->minx->rootp->minx__DOT__irq_copy_complete) irq_copy_complete_old = 0;
-
-        // At rising edge of clock
-        data_sent = false;
-
-
-        // Check for errors
-        {
-            if(sim->minx->rootp->minx__DOT__cpu__DOT__state == 2 && sim->minx->pl == 0 && !sim->minx->bus_ack)
-            {
-                if(sim->minx->rootp->minx__DOT__cpu__DOT__microaddress == 0 &&
-                   sim->minx->rootp->minx__DOT__cpu__DOT__extended_opcode != 0x1AE
-                ){
-                    PRINTE("** Instruction 0x%x not implemented at 0x%x, timestamp: %llu**\n", sim->minx->rootp->minx__DOT__cpu__DOT__extended_opcode, sim->minx->rootp->minx__DOT__cpu__DOT__top_address, sim->timestamp);
-                }
-            }
-
-            //if(
-            //    (sim->minx->sync == 1) &&
-            //    (sim->minx->pk == 0) &&
-            //    sim->minx->iack == 0 &&
-            //    sim->minx->rootp->minx__DOT__clk_ce &&
-            //    !sim->minx->bus_ack)
-            //{
-            //    printf("^ 0x%x\n", sim->minx->address_out);
-            //}
-
-            if(
-                (sim->minx->sync == 1) &&
-                (sim->minx->pl == 0) &&
-                (sim->minx->rootp->minx__DOT__cpu__DOT__micro_op & 0x1000) &&
-                sim->minx->iack == 0 &&
-                sim->minx->rootp->minx__DOT__clk_ce &&
-                !sim->minx->bus_ack)
-            {
-                if(irq_processing)
-                    irq_processing = false;
-                else
-                {
-                    uint8_t num_cycles        = num_cycles_since_sync;
-                    uint16_t extended_opcode  = sim->minx->rootp->minx__DOT__cpu__DOT__extended_opcode;
-                    uint8_t num_cycles_actual = instruction_cycles[2*extended_opcode];
-                    uint8_t num_cycles_actual_branch = instruction_cycles[2*extended_opcode+1];
-
-
-                    if(num_cycles != num_cycles_actual)
-                        if(num_cycles != num_cycles_actual_branch || num_cycles_actual_branch == 0)
-                            PRINTE(" ** Discrepancy found in number of cycles of instruction 0x%x: %d, %d, timestamp: %llu** \n", extended_opcode, num_cycles, num_cycles_actual, sim->timestamp);
-
-                    //if(sim->minx->address_out == 0x4C5C)
-                    //    printf("^ address: 0x%x, A: 0x%x\n", 0x4C5C, sim->minx->rootp->minx__DOT__cpu__DOT__BA & 0xFF);
-
-                    //if(!sim->instructions_executed[extended_opcode])
-                    //    printf("Instruction 0x%x executed for the first time, at 0x%x, timestamp: %llu.\n", extended_opcode, sim->minx->rootp->minx__DOT__cpu__DOT__top_address, sim->timestamp);
-                    sim->instructions_executed[extended_opcode] = 1;
-                }
-            }
-
-            if(sim->minx->rootp->minx__DOT__cpu__DOT__not_implemented_addressing_error == 1)
-                PRINTE(" ** Addressing not implemented error: 0x%llx, timestamp: %llu** \n", (sim->minx->rootp->minx__DOT__cpu__DOT__micro_op & 0x3F00000) >> 20, sim->timestamp);
-
-            if(sim->minx->rootp->minx__DOT__cpu__DOT__not_implemented_jump_error == 1)
-                PRINTE(" ** Jump not implemented error, 0x%llx, timestamp: %llu** \n", (sim->minx->rootp->minx__DOT__cpu__DOT__micro_op & 0x7C000) >> 14, sim->timestamp);
-
-            if(sim->minx->rootp->minx__DOT__cpu__DOT__not_implemented_data_out_error == 1)
-                PRINTE(" ** Data-out not implemented error, timestamp: %llu** \n", sim->timestamp);
-
-            if(sim->minx->rootp->minx__DOT__cpu__DOT__not_implemented_mov_src_error == 1)
-                PRINTE(" ** Mov src not implemented error, timestamp: %llu** \n", sim->timestamp);
-
-            if(sim->minx->rootp->minx__DOT__cpu__DOT__not_implemented_write_error == 1)
-                PRINTE(" ** Write not implemented error, timestamp: %llu** \n", sim->timestamp);
-
-            if(sim->minx->rootp->minx__DOT__cpu__DOT__alu_op_error == 1)
-                PRINTE(" ** Alu not implemented error, timestamp: %llu** \n", sim->timestamp);
-
-            if(sim->minx->rootp->minx__DOT__cpu__DOT__not_implemented_alu_pack_ops_error == 1)
-                PRINTE(" ** Alu packed operations not implemented error, sim->timestamp: %llu, 0x%x** \n", sim->timestamp, sim->minx->rootp->minx__DOT__cpu__DOT__top_address);
-
-            if(sim->minx->rootp->minx__DOT__cpu__DOT__not_implemented_divzero_error == 1)
-                PRINTE(" ** Division by zero exception not implemented error, sim->timestamp: %llu**\n", sim->timestamp);
-
-            if(sim->minx->rootp->minx__DOT__cpu__DOT__SP > 0x2000 && sim->minx->pl == 0)
-            {
-                PRINTE(" ** Stack overflow, timestamp: %llu**\n", sim->timestamp);
-                break;
-            }
-        }
-
-        //static bool once = false;
-        //if(sim->minx->rootp->minx__DOT__cpu__DOT__extended_opcode == 0x1AE)
-        //{
-        //    if(!once) printf("timestamp: %llu\n", sim->timestamp);
-        //    once = true;
-        //}
-
-        //if(sim->minx->rootp->minx__DOT__sound__DOT__reg_sound_volume == 3)
-        //    printf("%llu\n", sim->timestamp);
-
-        //if(
-        //    sim->minx->rootp->minx__DOT__cpu__DOT__postpone_exception == 1 &&
-        //    sim->minx->rootp->iack == 1 &&
-        //    sim->minx->rootp->minx__DOT__cpu__DOT__NB > 0
-        //){
-        //    if(!sim->tfp)
-        //        sim_dump_start(sim, "temp.vcd");
-        //}
-        //if(sim->timestamp == 82824492 - 10000000)
-        //    sim_dump_start(sim, "sim.vcd");
-
-        //if(sim->timestamp == 82824492 + 1000000)
-        //    sim_dump_stop(sim);
-
-        if(sim->minx->reset == 1 && reset_counter < 8)
-            ++reset_counter;
-        else if(reset_counter >= 8)
-        {
-            sim->minx->reset = 0;
-            reset_counter = 0;
-        }
-
-        //if(sim->minx->address_out == 0x1479 && sim->minx->bus_status == BUS_MEM_WRITE && sim->minx->write)
-        //{
-        //    printf("%llu, 0x%x, 0x%x\n", sim->timestamp, sim->minx->rootp->minx__DOT__cpu__DOT__top_address, sim->minx->data_out);
-        //}
-
-        if(sim->timestamp > 258 && sim->minx->iack == 1 && sim->minx->pl == 0)// && sim->minx->sync)
-        {
-            irq_processing = true;
-        }
-
-        if(sim->minx->bus_status == BUS_MEM_READ && sim->minx->pl == 0) // Check if PL=0 just to reduce spam.
-        {
-            // memory read
-            if(sim->minx->address_out < 0x1000)
-            {
-                // read from bios
-                sim->bios_touched[sim->minx->address_out & (sim->bios_file_size - 1)] = 1;
-                sim->minx->data_in = *(sim->bios + (sim->minx->address_out & (sim->bios_file_size - 1)));
-            }
-            else if(sim->minx->address_out < 0x2000)
-            {
-                // read from ram
-                uint32_t address = sim->minx->address_out & 0xFFF;
-                sim->minx->data_in = *(uint8_t*)(sim->memory + address);
-            }
-            else
-            {
-                // read from cartridge
-                sim->cartridge_touched[(sim->minx->address_out & 0x1FFFFF) & (sim->cartridge_file_size - 1)] = 1;
-                sim->minx->data_in = *(uint8_t*)(sim->cartridge + (sim->minx->address_out & 0x1FFFFF));
-            }
-
-            data_sent = true;
-        }
-        else if(sim->minx->bus_status == BUS_MEM_WRITE && sim->minx->write)
-        {
-            //if(sim->minx->address_out == 0x2085 && sim->minx->data_out > 0)
-            //    printf("0x%x: 0x%x, timestamp: %d\n", sim->minx->rootp->minx__DOT__cpu__DOT__top_address, sim->minx->data_out, sim->timestamp);
-
-            // memory write
-            if(sim->minx->address_out < 0x1000)
-            {
-                PRINTD("Program trying to write to bios at 0x%x, timestamp: %llu\n", sim->minx->address_out, sim->timestamp);
-            }
-            else if(sim->minx->address_out < 0x2000)
-            {
-                // write to ram
-                uint32_t address = sim->minx->address_out & 0xFFF;
-                *(uint8_t*)(sim->memory + address) = sim->minx->data_out;
-            }
-            else
-            {
-                PRINTD("Program trying to write to cartridge at 0x%x, timestamp: %llu\n", sim->minx->address_out, sim->timestamp);
-            }
-
-            data_sent = true;
-        }
-
-        if(sim->minx->rootp->minx__DOT__clk_ce)
-        {
-            if(sim->minx->sync && sim->minx->pl == 1)
-                num_cycles_since_sync = 0;
-
-            if(sim->minx->pl == 1 && !sim->minx->bus_ack)
-                ++num_cycles_since_sync;
-        }
-    }
-}
 // Contrast level on light and dark pixel
 const uint8_t contrast_level_map[64*2] = {
       0,   4,   //  0 (0x00)
@@ -653,10 +206,9 @@ const uint8_t contrast_level_map[64*2] = {
     240, 255,   // 63 (0x3F)
 };
 
-uint8_t* get_lcd_image(const SimData* sim)
+void get_lcd_image(const SimData* sim, uint8_t* image_data)
 {
     uint8_t contrast = sim->minx->rootp->minx__DOT__lcd__DOT__contrast;
-    uint8_t* image_data = new uint8_t[96*64];
 
     for (int yC=0; yC<8; yC++)
     {
@@ -672,58 +224,61 @@ uint8_t* get_lcd_image(const SimData* sim)
         }
     }
 
-    return image_data;
 }
 
-uint8_t* render_framebuffers(const SimData* sim)
+// Tables for render_framebuffers(). pixel_expansion spreads the 8 pixels
+// of a framebuffer byte over the bytes of a 64 bit word, one per pixel, so
+// adding the words of several frames counts how often each pixel was on.
+// contrast_blend maps that count to the blended gray level of a contrast.
+#define RENDER_NUM_FRAMES 4
+
+uint64_t pixel_expansion[256];
+uint8_t contrast_blend[64][RENDER_NUM_FRAMES + 1];
+
+void render_init_tables()
 {
-    uint8_t contrast = sim->minx->rootp->minx__DOT__lcd__DOT__contrast;
+    for(int data = 0; data < 256; ++data)
+    {
+        uint64_t pixels = 0;
+        for(int i = 0; i < 8; ++i)
+            pixels |= (uint64_t)((data >> i) & 1) << (8 * i);
+        pixel_expansion[data] = pixels;
+    }
+
+    for(int contrast = 0; contrast < 64; ++contrast)
+    {
+        int off = contrast_level_map[2*contrast];
+        int on  = contrast_level_map[2*contrast + 1];
+        for(int num_on = 0; num_on <= RENDER_NUM_FRAMES; ++num_on)
+            contrast_blend[contrast][num_on] = (num_on * on + (RENDER_NUM_FRAMES - num_on) * off) / RENDER_NUM_FRAMES;
+    }
+}
 
-    uint8_t* image_data = new uint8_t[96*64];
+// Blends the last RENDER_NUM_FRAMES frames into image_data (96x64, bottom
+// row first), like the lcd's slow pixels do. Needs render_init_tables().
+void render_framebuffers(const SimData* sim, uint8_t* image_data)
+{
+    uint8_t contrast = sim->minx->rootp->minx__DOT__lcd__DOT__contrast;
+    const uint8_t* blend = contrast_blend[contrast];
 
-    //static uint8_t levels_covered[16] = {};
+    const uint8_t* frames[RENDER_NUM_FRAMES];
+    for(int k = 0; k < RENDER_NUM_FRAMES; ++k)
+        frames[k] = sim->framebuffers + 768 * ((sim->fb_write_index + 7 - k) % 8);
 
     for (int yC=0; yC<8; yC++)
     {
         for (int xC=0; xC<96; xC++)
         {
-            uint8_t fb_idx = (sim->fb_write_index + 7) % 8;
-            uint8_t d0 = sim->framebuffers[768 * fb_idx + yC * 96 + xC];
-            fb_idx = (sim->fb_write_index + 6) % 8;
-            uint8_t d1 = sim->framebuffers[768 * fb_idx + yC * 96 + xC];
-            fb_idx = (sim->fb_write_index + 5) % 8;
-            uint8_t d2 = sim->framebuffers[768 * fb_idx + yC * 96 + xC];
-            fb_idx = (sim->fb_write_index + 4) % 8;
-            uint8_t d3 = sim->framebuffers[768 * fb_idx + yC * 96 + xC];
-            fb_idx = (sim->fb_write_index + 3) % 8;
-            uint8_t d4 = sim->framebuffers[768 * fb_idx + yC * 96 + xC];
-            fb_idx = (sim->fb_write_index + 2) % 8;
-            uint8_t d5 = sim->framebuffers[768 * fb_idx + yC * 96 + xC];
-            fb_idx = (sim->fb_write_index + 1) % 8;
-            uint8_t d6 = sim->framebuffers[768 * fb_idx + yC * 96 + xC];
+            int offset = yC * 96 + xC;
+            uint64_t num_on = 0;
+            for(int k = 0; k < RENDER_NUM_FRAMES; ++k)
+                num_on += pixel_expansion[frames[k][offset]];
+
+            uint8_t* column = image_data + 96 * (63 - 8 * yC) + xC;
             for(int i = 0; i < 8; ++i)
-            {
-                int idx = 96 * (63 - 8 * yC - i) + xC;
-                float output = 0.0;
-                output += ((d0 >> i) & 1)? contrast_level_map[2*contrast+1]: contrast_level_map[2*contrast];
-                output += ((d1 >> i) & 1)? contrast_level_map[2*contrast+1]: contrast_level_map[2*contrast];
-                output += ((d2 >> i) & 1)? contrast_level_map[2*contrast+1]: contrast_level_map[2*contrast];
-                output += ((d3 >> i) & 1)? contrast_level_map[2*contrast+1]: contrast_level_map[2*contrast];
-                //output += ((d4 >> i) & 1)? contrast_level_map[2*contrast+1]: contrast_level_map[2*contrast];
-                //output += ((d5 >> i) & 1)? contrast_level_map[2*contrast+1]: contrast_level_map[2*contrast];
-                //output += 1.0 * (((~d6 >> i) & 1)? 255.0: 255.0 * (1.0 - (float)contrast / 0x20));
-                image_data[idx] = output / 4.0;
-            }
+                column[-96 * i] = blend[(num_on >> (8 * i)) & 0xFF];
         }
     }
-
-    //printf("%d%d%d%d\n", frames01_same, frames12_same, frames23_same, frames34_same);
-
-    //for(int i = 0; i < 16; ++i)
-    //    printf("%d", levels_covered[i]);
-    //printf("\n");
-
-    return image_data;
 }
 
 void audio_callback(void* userdata, uint8_t* stream, int len)
@@ -770,7 +325,106 @@ int main(int argc, char** argv)
     //const char* rom_filepath = "data/pokemon_puzzle_collection_j.min";
     //const char* rom_filepath = "data/pokemon_puzzle_collection_vol2_j.min";
     //const char* rom_filepath = "data/pokemon_pinball_mini_j.min";
-    sim_init(&sim, rom_filepath);
+    if(!sim_init(&sim, rom_filepath))
+        return -1;
+    sim_enable_coverage(&sim);
+
+    // The d hotkey dumps to sim.fst or sim.vcd, -fst/-vcd override the
+    // default format of the build and -trace-filter limits the dump to the
+    // scopes listed in a file. -trace-start/-trace-stop/-trace-cycles dump
+    // a window given by trigger expressions instead, see trace_trigger.h.
+    //
+    // F5 saves the machine state to sim.sav (or the file given by -state)
+    // and F9 restores it, see sim_state.h; -load-state starts from a state
+    // and -boot-cache from the end of the bios boot, cached in a directory.
+    //
+    // Backspace rewinds by the interval of the rewind buffer (10 frames, set
+    // with -rewind-interval), shift+backspace by a single frame, see
+    // sim_rewind.h. -rewind-budget sets its memory budget in MB.
+    //
+    // -record records the inputs to a movie, -replay replays one and
+    // ignores the keyboard until it ends, see movie.h.
+    //
+    // The eeprom is kept next to the rom, in a .eep file of the same name,
+    // or in the file given by -eeprom, see sim_open_eeprom(). -no-eeprom
+    // starts from a blank one every time, as do runs recording or replaying
+    // a movie unless -eeprom is given: movies don't record the eeprom.
+    const char* dump_filepath = SIM_DUMP_FILEPATH;
+    const char* state_filepath = "sim.sav";
+    const char* load_state = nullptr;
+    const char* boot_cache = nullptr;
+    uint32_t rewind_interval = 10;
+    size_t rewind_budget     = 32;
+    const char* record_movie = nullptr;
+    const char* replay_movie = nullptr;
+    const char* eeprom_filepath = nullptr;
+    bool no_eeprom = false;
+    const char* trace_start = nullptr;
+    const char* trace_stop  = nullptr;
+    uint64_t trace_cycles   = 0;
+    for(int arg = 1; arg < argc; ++arg)
+    {
+        if(strcmp(argv[arg], "-fst") == 0)
+            dump_filepath = "sim.fst";
+        else if(strcmp(argv[arg], "-vcd") == 0)
+            dump_filepath = "sim.vcd";
+        else if(strcmp(argv[arg], "-trace-filter") == 0 && arg + 1 < argc)
+            sim.trace_filter = argv[++arg];
+        else if(strcmp(argv[arg], "-trace-start") == 0 && arg + 1 < argc)
+            trace_start = argv[++arg];
+        else if(strcmp(argv[arg], "-trace-stop") == 0 && arg + 1 < argc)
+            trace_stop = argv[++arg];
+        else if(strcmp(argv[arg], "-trace-cycles") == 0 && arg + 1 < argc)
+            trace_cycles = strtoull(argv[++arg], nullptr, 0);
+        else if(strcmp(argv[arg], "-state") == 0 && arg + 1 < argc)
+            state_filepath = argv[++arg];
+        else if(strcmp(argv[arg], "-load-state") == 0 && arg + 1 < argc)
+            load_state = argv[++arg];
+        else if(strcmp(argv[arg], "-boot-cache") == 0 && arg + 1 < argc)
+            boot_cache = argv[++arg];
+        else if(strcmp(argv[arg], "-rewind-interval") == 0 && arg + 1 < argc)
+            rewind_interval = strtoul(argv[++arg], nullptr, 0);
+        else if(strcmp(argv[arg], "-rewind-budget") == 0 && arg + 1 < argc)
+            rewind_budget = strtoul(argv[++arg], nullptr, 0);
+        else if(strcmp(argv[arg], "-record") == 0 && arg + 1 < argc)
+            record_movie = argv[++arg];
+        else if(strcmp(argv[arg], "-replay") == 0 && arg + 1 < argc)
+            replay_movie = argv[++arg];
+        else if(strcmp(argv[arg], "-eeprom") == 0 && arg + 1 < argc)
+            eeprom_filepath = argv[++arg];
+        else if(strcmp(argv[arg], "-no-eeprom") == 0)
+            no_eeprom = true;
+    }
+
+    char default_eeprom_filepath[512];
+    if(!eeprom_filepath && !no_eeprom && !record_movie && !replay_movie)
+    {
+        snprintf(default_eeprom_filepath, sizeof(default_eeprom_filepath), "%s", rom_filepath);
+        char* extension = strrchr(default_eeprom_filepath, '.');
+        if(extension && !strchr(extension, '/')) *extension = '\0';
+        strncat(default_eeprom_filepath, ".eep", sizeof(default_eeprom_filepath) - strlen(default_eeprom_filepath) - 1);
+        eeprom_filepath = default_eeprom_filepath;
+    }
+    if(eeprom_filepath && !sim_open_eeprom(&sim, eeprom_filepath))
+        return -1;
+
+    if(load_state)
+    {
+        if(!sim_load_state(&sim, load_state))
+            return -1;
+    }
+    else if(boot_cache)
+        sim_boot_cached(&sim, boot_cache);
+
+    if(replay_movie && !sim_replay_movie(&sim, replay_movie))
+        return -1;
+    else if(record_movie && !sim_record_movie(&sim, record_movie))
+        return -1;
+
+    SimRewind* rewind = sim_rewind_create(&sim, rewind_interval, rewind_budget * 1024 * 1024);
+
+    if(trace_start && !sim_set_trace_window(&sim, trace_start, trace_stop, trace_cycles, dump_filepath))
+        return -1;
 
     // Create window and gl context, and game controller
     int window_width = 960/2;
@@ -863,8 +517,12 @@ int main(int argc, char** argv)
     bool program_is_running = true;
     bool dump_sim = false;
     int eeprom_dump_id = 0;
+    uint16_t keys = sim.minx->keys_active;
+    uint8_t lcd_image[96*64];
+    render_init_tables();
     while(program_is_running)
     {
+        bool reset = false;
         //printf("%d, %d\n", sim.minx->rootp->minx__DOT__rtc__DOT__timer, sim.minx->rootp->minx__DOT__eeprom__DOT__rom.m_storage[0x1FF6]);
         // Process input
         SDL_Event sdl_event;
@@ -883,7 +541,7 @@ int main(int argc, char** argv)
                     if(!dump_sim)
                     {
                         dump_sim = true;
-                        sim_dump_start(&sim, "sim.vcd");
+                        sim_dump_start(&sim, dump_filepath);
                     }
                     else
                     {
@@ -891,12 +549,32 @@ int main(int argc, char** argv)
                         sim_dump_stop(&sim);
                     }
                 }
+                else if(sdl_event.key.keysym.sym == SDLK_f)
+                {
+                    sim.fast_forward = !sim.fast_forward;
+                    printf("HALT fast-forward %s.\n", sim.fast_forward? "on": "off");
+                }
                 else if(sdl_event.key.keysym.sym == SDLK_e)
                 {
                     char filename[256];
                     snprintf(filename, 256, "eeprom%03d.bin", eeprom_dump_id++);
                     sim_dump_eeprom(&sim, filename);
                 }
+                else if(sdl_event.key.keysym.sym == SDLK_F5)
+                    sim_save_state(&sim, state_filepath);
+                else if(sdl_event.key.keysym.sym == SDLK_F9)
+                {
+                    sim_stop_movie(&sim);
+                    sim_load_state(&sim, state_filepath);
+                }
+                else if(sdl_event.key.keysym.sym == SDLK_BACKSPACE)
+                {
+                    sim_stop_movie(&sim);
+                    uint32_t num_frames = (sdl_event.key.keysym.mod & KMOD_SHIFT)? 1: rewind->interval;
+                    uint32_t frame = (sim.frame_count > num_frames)? sim.frame_count - num_frames: 0;
+                    frame = sim_rewind_to_frame(rewind, &sim, frame);
+                    printf("Rewound to frame %u, %zu KB of history back to frame %u.\n", frame, sim_rewind_size(rewind) / 1024, sim_rewind_oldest_frame(rewind));
+                }
                 else
                 {
                     switch(sdl_event.key.keysym.sym){
@@ -904,36 +582,36 @@ int main(int argc, char** argv)
                         program_is_running = false;
                         break;
                     case SDLK_UP:
-                        sim.minx->keys_active |= 0x08;
+                        keys |= 0x08;
                         break;
                     case SDLK_DOWN:
-                        sim.minx->keys_active |= 0x10;
+                        keys |= 0x10;
                         break;
                     case SDLK_RIGHT:
-                        sim.minx->keys_active |= 0x40;
+                        keys |= 0x40;
                         break;
                     case SDLK_LEFT:
-                        sim.minx->keys_active |= 0x20;
+                        keys |= 0x20;
                         break;
                     case SDLK_x: // A
-                        sim.minx->keys_active |= 0x01;
+                        keys |= 0x01;
                         break;
                     case SDLK_z: // B
-                        sim.minx->keys_active |= 0x02;
+                        keys |= 0x02;
                         break;
                     case SDLK_r: // reset
-                        sim.minx->reset = 1;
+                        reset = true;
                         break;
                     case SDLK_s: // C
                     case SDLK_c:
-                        sim.minx->keys_active |= 0x04;
+                        keys |= 0x04;
                         break;
                     case SDLK_t: // Shock
                     case SDLK_j:
-                        sim.minx->keys_active |= 0x100;
+                        keys |= 0x100;
                         break;
                     case SDLK_b: // Power
-                        sim.minx->keys_active |= 0x80;
+                        keys |= 0x80;
                         break;
                     default:
                         break;
@@ -944,33 +622,33 @@ int main(int argc, char** argv)
             {
                 switch(sdl_event.key.keysym.sym){
                 case SDLK_UP:
-                    sim.minx->keys_active &= ~0x08;
+                    keys &= ~0x08;
                     break;
                 case SDLK_DOWN:
-                    sim.minx->keys_active &= ~0x10;
+                    keys &= ~0x10;
                     break;
                 case SDLK_RIGHT:
-                    sim.minx->keys_active &= ~0x40;
+                    keys &= ~0x40;
                     break;
                 case SDLK_LEFT:
-                    sim.minx->keys_active &= ~0x20;
+                    keys &= ~0x20;
                     break;
                 case SDLK_x: // A
-                    sim.minx->keys_active &= ~0x01;
+                    keys &= ~0x01;
                     break;
                 case SDLK_z: // B
-                    sim.minx->keys_active &= ~0x02;
+                    keys &= ~0x02;
                     break;
                 case SDLK_s: // C
                 case SDLK_c:
-                    sim.minx->keys_active &= ~0x04;
+                    keys &= ~0x04;
                     break;
                 case SDLK_t: // Shock
                 case SDLK_j:
-                    sim.minx->keys_active &= ~0x100;
+                    keys &= ~0x100;
                     break;
                 case SDLK_b: // Power
-                    sim.minx->keys_active &= ~0x80;
+                    keys &= ~0x80;
                     break;
                 default:
                     break;
@@ -993,6 +671,14 @@ int main(int argc, char** argv)
             }
         }
 
+        // Inputs go through sim_set_keys() so that movies see them.
+        if(!sim_is_replaying(&sim))
+        {
+            sim_set_keys(&sim, keys);
+            if(reset) sim_reset(&sim);
+        }
+        else if(sim.movie->next == sim.movie->num_events)
+            sim_stop_movie(&sim);
 
         uint64_t new_clock = SDL_GetPerformanceCounter();
         double frame_sec = double(new_clock - current_clock) / cpu_frequency;
@@ -1000,16 +686,19 @@ int main(int argc, char** argv)
         //printf("%f\n", 4000000 * frame_sec);
 
         if(sim_is_running)
+        {
             simulate_steps(&sim, min(num_sim_steps, (int)4000000 * frame_sec), &sim_audio_buffer);
-        uint8_t* lcd_image = render_framebuffers(&sim);
-        //uint8_t* lcd_image = get_lcd_image(&sim);
+            sim_rewind_step(rewind, &sim);
+        }
+        render_framebuffers(&sim, lcd_image);
+        //get_lcd_image(&sim, lcd_image);
         gl_renderer_draw(96, 64, lcd_image);
-        delete[] lcd_image;
 
         SDL_GL_SwapWindow(window);
     }
 
     sim_dump_stop(&sim);
+    sim_rewind_destroy(rewind);
 
     SDL_CloseAudioDevice(audio_device_id);
     SDL_GL_DeleteContext(gl_context);
@@ -1031,5 +720,8 @@ int main(int argc, char** argv)
         total_touched += sim.instructions_executed[i];
     printf("%zu instructions out of total 608 executed.\n", total_touched);
 
+    // Also saves the eeprom file, see sim_open_eeprom().
+    sim_destroy(&sim);
+
     return 0;
 }
@@ -0,0 +1,122 @@
+// Input movie: every change of the inputs of a run, with the cycle it
+// happened on, so the run can be replayed exactly, see sim_record_movie()
+// and sim_replay_movie().
+//
+// The file is a MovieHeader followed by one MovieEvent per change, in the
+// byte order of the host. The header records where the run started: the
+// cycle (0 from reset, later from a save state or the boot cache), the
+// cartridge and the wall clock time the eeprom clock was set from.
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+
+#define MOVIE_VERSION 1
+
+// MovieEvent flags.
+#define MOVIE_RESET 1
+
+struct MovieHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    uint64_t start_cycle;
+    uint64_t cartridge_hash;
+    int64_t start_time;
+};
+
+struct MovieEvent
+{
+    uint64_t cycle;
+    uint16_t keys;
+    uint8_t flags;
+    uint8_t reserved[5];
+};
+
+static_assert(sizeof(MovieHeader) == 40, "MovieHeader must be packed");
+static_assert(sizeof(MovieEvent) == 16, "MovieEvent must be packed");
+
+struct Movie
+{
+    MovieHeader header;
+
+    // Recording: the events are written as they happen.
+    FILE* fp;
+
+    // Replaying: all the events, and the next one to apply.
+    MovieEvent* events;
+    uint32_t num_events;
+    uint32_t next;
+};
+
+Movie* movie_create(const char* filepath, uint64_t start_cycle, uint64_t cartridge_hash, int64_t start_time)
+{
+    FILE* fp = fopen(filepath, "wb");
+    if(!fp)
+    {
+        fprintf(stderr, "Error opening movie %s.\n", filepath);
+        return nullptr;
+    }
+
+    Movie* movie = (Movie*) calloc(1, sizeof(Movie));
+    memcpy(movie->header.magic, "MINXMOV", 8);
+    movie->header.version        = MOVIE_VERSION;
+    movie->header.record_size    = sizeof(MovieEvent);
+    movie->header.start_cycle    = start_cycle;
+    movie->header.cartridge_hash = cartridge_hash;
+    movie->header.start_time     = start_time;
+    movie->fp = fp;
+    fwrite(&movie->header, sizeof(movie->header), 1, fp);
+    return movie;
+}
+
+void movie_append(Movie* movie, uint64_t cycle, uint16_t keys, uint8_t flags)
+{
+    MovieEvent event = {};
+    event.cycle = cycle;
+    event.keys  = keys;
+    event.flags = flags;
+    fwrite(&event, sizeof(event), 1, movie->fp);
+}
+
+Movie* movie_open(const char* filepath)
+{
+    FILE* fp = fopen(filepath, "rb");
+    if(!fp)
+    {
+        fprintf(stderr, "Error opening movie %s.\n", filepath);
+        return nullptr;
+    }
+
+    Movie* movie = (Movie*) calloc(1, sizeof(Movie));
+    if(fread(&movie->header, sizeof(movie->header), 1, fp) != 1 ||
+       memcmp(movie->header.magic, "MINXMOV", 8) != 0 ||
+       movie->header.version != MOVIE_VERSION ||
+       movie->header.record_size != sizeof(MovieEvent))
+    {
+        fprintf(stderr, "%s is not a version %u movie.\n", filepath, MOVIE_VERSION);
+        fclose(fp);
+        free(movie);
+        return nullptr;
+    }
+
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, sizeof(MovieHeader), SEEK_SET);
+    movie->num_events = (size - sizeof(MovieHeader)) / sizeof(MovieEvent);
+    movie->events = (MovieEvent*) malloc(sizeof(MovieEvent) * (movie->num_events + 1));
+    movie->num_events = fread(movie->events, sizeof(MovieEvent), movie->num_events, fp);
+    fclose(fp);
+    return movie;
+}
+
+void movie_close(Movie* movie)
+{
+    if(movie->fp)
+        fclose(movie->fp);
+    free(movie->events);
+    free(movie);
+}
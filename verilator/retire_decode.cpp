@@ -0,0 +1,48 @@
+#include "retire_log.h"
+#include "retire_print.h"
+
+// Prints a retire log (see retire_log.h) as text, one instruction per line,
+// in the format of retire_print.h.
+//
+// Usage: retire_decode [-s first_cycle] [-n count] log.rlog
+
+int main(int argc, char** argv)
+{
+    uint64_t first_cycle = 0;
+    uint64_t count = UINT64_MAX;
+
+    int arg = 1;
+    for(; arg < argc && argv[arg][0] == '-'; ++arg)
+    {
+        if(strcmp(argv[arg], "-s") == 0 && arg + 1 < argc)
+            first_cycle = strtoull(argv[++arg], nullptr, 0);
+        else if(strcmp(argv[arg], "-n") == 0 && arg + 1 < argc)
+            count = strtoull(argv[++arg], nullptr, 0);
+        else
+        {
+            fprintf(stderr, "Unknown option %s.\n", argv[arg]);
+            return -1;
+        }
+    }
+
+    if(arg + 1 != argc)
+    {
+        fprintf(stderr, "Usage: %s [-s first_cycle] [-n count] log.rlog\n", argv[0]);
+        return -1;
+    }
+
+    RetireLogReader* reader = retire_log_open_read(argv[arg]);
+    if(!reader)
+        return -1;
+
+    RetireRecord record;
+    while(count > 0 && retire_log_read(reader, &record))
+    {
+        if(record.cycle < first_cycle) continue;
+        retire_print_record(stdout, &record);
+        --count;
+    }
+
+    retire_log_close_read(reader);
+    return 0;
+}
@@ -0,0 +1,310 @@
+// Instruction retire log: one fixed size binary record per executed
+// instruction, with the cycle, address, opcode and the register file.
+//
+// Much cheaper to produce than a VCD and small enough to keep for a whole
+// run, it is the format to use for cpu debugging and for comparing runs
+// against each other or against other emulators. Decode it with
+// retire_decode (see build_tools.sh).
+//
+// The file starts with a RetireLogHeader followed by the records, raw or,
+// when built with SIM_HAVE_LZ4, as a single LZ4 frame. Both are written in
+// the byte order of the host, which is little endian on everything we run
+// on.
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+
+#ifndef SIM_HAVE_LZ4
+#define SIM_HAVE_LZ4 0
+#endif
+#if SIM_HAVE_LZ4
+#include <lz4frame.h>
+#endif
+
+#define RETIRE_LOG_VERSION 1
+#define RETIRE_LOG_LZ4 0x1
+
+// Records are buffered and written in blocks of this many.
+#define RETIRE_LOG_BLOCK_RECORDS 16384
+
+struct RetireLogHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    uint32_t flags;
+    uint32_t reserved;
+};
+
+struct RetireRecord
+{
+    // Cycle (timestamp / 2) the instruction retired on.
+    uint64_t cycle;
+
+    uint16_t top_address;
+    uint16_t extended_opcode;
+
+    uint16_t PC;
+    uint16_t SP;
+    uint16_t BA;
+    uint16_t HL;
+    uint16_t IX;
+    uint16_t IY;
+
+    uint8_t SC;
+    uint8_t CB;
+    uint8_t NB;
+    uint8_t EP;
+    uint8_t XP;
+    uint8_t YP;
+    uint8_t BR;
+
+    // Number of cycles the instruction took.
+    uint8_t num_cycles;
+};
+
+static_assert(sizeof(RetireLogHeader) == 24, "RetireLogHeader must be packed");
+static_assert(sizeof(RetireRecord) == 32, "RetireRecord must be packed");
+
+struct RetireLog
+{
+    FILE* fp;
+    RetireRecord* records;
+    uint32_t num_records;
+    uint64_t total_records;
+
+    bool lz4;
+#if SIM_HAVE_LZ4
+    LZ4F_cctx* cctx;
+    char* compressed;
+    size_t compressed_capacity;
+#endif
+};
+
+// Opens a log for writing. The records are LZ4 compressed if filepath ends
+// in .lz4, which needs SIM_HAVE_LZ4.
+RetireLog* retire_log_open(const char* filepath)
+{
+    size_t length = strlen(filepath);
+    bool lz4 = length >= 4 && strcmp(filepath + length - 4, ".lz4") == 0;
+#if !SIM_HAVE_LZ4
+    if(lz4)
+    {
+        fprintf(stderr, "Built without SIM_HAVE_LZ4, can't write %s.\n", filepath);
+        return nullptr;
+    }
+#endif
+
+    FILE* fp = fopen(filepath, "wb");
+    if(!fp)
+    {
+        fprintf(stderr, "Error opening retire log %s.\n", filepath);
+        return nullptr;
+    }
+
+    RetireLogHeader header = {};
+    memcpy(header.magic, "MINXRET", 8);
+    header.version     = RETIRE_LOG_VERSION;
+    header.record_size = sizeof(RetireRecord);
+    header.flags       = lz4? RETIRE_LOG_LZ4: 0;
+    fwrite(&header, sizeof(header), 1, fp);
+
+    RetireLog* log = (RetireLog*) calloc(1, sizeof(RetireLog));
+    log->fp      = fp;
+    log->records = (RetireRecord*) malloc(sizeof(RetireRecord) * RETIRE_LOG_BLOCK_RECORDS);
+    log->lz4     = lz4;
+
+#if SIM_HAVE_LZ4
+    if(lz4)
+    {
+        LZ4F_createCompressionContext(&log->cctx, LZ4F_VERSION);
+        log->compressed_capacity = LZ4F_compressBound(sizeof(RetireRecord) * RETIRE_LOG_BLOCK_RECORDS, nullptr);
+        if(log->compressed_capacity < LZ4F_HEADER_SIZE_MAX)
+            log->compressed_capacity = LZ4F_HEADER_SIZE_MAX;
+        log->compressed = (char*) malloc(log->compressed_capacity);
+
+        size_t size = LZ4F_compressBegin(log->cctx, log->compressed, log->compressed_capacity, nullptr);
+        fwrite(log->compressed, 1, size, fp);
+    }
+#endif
+
+    return log;
+}
+
+void retire_log_flush(RetireLog* log)
+{
+    if(log->num_records == 0) return;
+
+    size_t size = sizeof(RetireRecord) * log->num_records;
+#if SIM_HAVE_LZ4
+    if(log->lz4)
+    {
+        size = LZ4F_compressUpdate(log->cctx, log->compressed, log->compressed_capacity, log->records, size, nullptr);
+        if(LZ4F_isError(size))
+            fprintf(stderr, "Error compressing retire log: %s\n", LZ4F_getErrorName(size));
+        else
+            fwrite(log->compressed, 1, size, log->fp);
+        log->num_records = 0;
+        return;
+    }
+#endif
+
+    fwrite(log->records, 1, size, log->fp);
+    log->num_records = 0;
+}
+
+// Returns the record to fill in for the next instruction.
+static inline RetireRecord* retire_log_next(RetireLog* log)
+{
+    if(log->num_records == RETIRE_LOG_BLOCK_RECORDS)
+        retire_log_flush(log);
+    ++log->total_records;
+    return log->records + log->num_records++;
+}
+
+void retire_log_close(RetireLog* log)
+{
+    retire_log_flush(log);
+#if SIM_HAVE_LZ4
+    if(log->lz4)
+    {
+        size_t size = LZ4F_compressEnd(log->cctx, log->compressed, log->compressed_capacity, nullptr);
+        if(!LZ4F_isError(size))
+            fwrite(log->compressed, 1, size, log->fp);
+        LZ4F_freeCompressionContext(log->cctx);
+        free(log->compressed);
+    }
+#endif
+    fclose(log->fp);
+    free(log->records);
+    free(log);
+}
+
+// Reading
+
+#define RETIRE_LOG_READ_BUFFER (256 * 1024)
+
+struct RetireLogReader
+{
+    FILE* fp;
+    bool lz4;
+
+    // Decoded bytes not handed out yet.
+    uint8_t* out;
+    size_t out_pos;
+    size_t out_size;
+
+#if SIM_HAVE_LZ4
+    LZ4F_dctx* dctx;
+    uint8_t* in;
+    size_t in_pos;
+    size_t in_size;
+#endif
+};
+
+RetireLogReader* retire_log_open_read(const char* filepath)
+{
+    FILE* fp = fopen(filepath, "rb");
+    if(!fp)
+    {
+        fprintf(stderr, "Error opening retire log %s.\n", filepath);
+        return nullptr;
+    }
+
+    RetireLogHeader header;
+    if(fread(&header, sizeof(header), 1, fp) != 1 || memcmp(header.magic, "MINXRET", 8) != 0)
+    {
+        fprintf(stderr, "%s is not a retire log.\n", filepath);
+        fclose(fp);
+        return nullptr;
+    }
+    if(header.version != RETIRE_LOG_VERSION || header.record_size != sizeof(RetireRecord))
+    {
+        fprintf(stderr, "%s has version %u, expected %u.\n", filepath, header.version, RETIRE_LOG_VERSION);
+        fclose(fp);
+        return nullptr;
+    }
+
+    bool lz4 = header.flags & RETIRE_LOG_LZ4;
+#if !SIM_HAVE_LZ4
+    if(lz4)
+    {
+        fprintf(stderr, "%s is LZ4 compressed, rebuild with SIM_HAVE_LZ4.\n", filepath);
+        fclose(fp);
+        return nullptr;
+    }
+#endif
+
+    RetireLogReader* reader = (RetireLogReader*) calloc(1, sizeof(RetireLogReader));
+    reader->fp  = fp;
+    reader->lz4 = lz4;
+    reader->out = (uint8_t*) malloc(RETIRE_LOG_READ_BUFFER);
+#if SIM_HAVE_LZ4
+    if(lz4)
+    {
+        LZ4F_createDecompressionContext(&reader->dctx, LZ4F_VERSION);
+        reader->in = (uint8_t*) malloc(RETIRE_LOG_READ_BUFFER);
+    }
+#endif
+    return reader;
+}
+
+// Reads the next record, returns false at the end of the log.
+bool retire_log_read(RetireLogReader* reader, RetireRecord* record)
+{
+    while(reader->out_size - reader->out_pos < sizeof(RetireRecord))
+    {
+        memmove(reader->out, reader->out + reader->out_pos, reader->out_size - reader->out_pos);
+        reader->out_size -= reader->out_pos;
+        reader->out_pos = 0;
+
+        if(!reader->lz4)
+        {
+            size_t size = fread(reader->out + reader->out_size, 1, RETIRE_LOG_READ_BUFFER - reader->out_size, reader->fp);
+            if(size == 0) return false;
+            reader->out_size += size;
+            continue;
+        }
+
+#if SIM_HAVE_LZ4
+        if(reader->in_pos == reader->in_size)
+        {
+            reader->in_pos  = 0;
+            reader->in_size = fread(reader->in, 1, RETIRE_LOG_READ_BUFFER, reader->fp);
+            if(reader->in_size == 0) return false;
+        }
+
+        size_t out_size = RETIRE_LOG_READ_BUFFER - reader->out_size;
+        size_t in_size  = reader->in_size - reader->in_pos;
+        size_t result = LZ4F_decompress(reader->dctx, reader->out + reader->out_size, &out_size, reader->in + reader->in_pos, &in_size, nullptr);
+        if(LZ4F_isError(result))
+        {
+            fprintf(stderr, "Error decompressing retire log: %s\n", LZ4F_getErrorName(result));
+            return false;
+        }
+        reader->in_pos   += in_size;
+        reader->out_size += out_size;
+#endif
+    }
+
+    memcpy(record, reader->out + reader->out_pos, sizeof(RetireRecord));
+    reader->out_pos += sizeof(RetireRecord);
+    return true;
+}
+
+void retire_log_close_read(RetireLogReader* reader)
+{
+#if SIM_HAVE_LZ4
+    if(reader->lz4)
+    {
+        LZ4F_freeDecompressionContext(reader->dctx);
+        free(reader->in);
+    }
+#endif
+    fclose(reader->fp);
+    free(reader->out);
+    free(reader);
+}
@@ -0,0 +1,40 @@
+// Prints retire log records as text, one instruction per line:
+//
+//   cycle  CB:address  opcode  name  cycles  registers  flags
+//
+// The names come from instruction_names.h, generated from the microcode
+// comments by scripts/make_instruction_names.py.
+#pragma once
+
+#include "retire_log.h"
+#include "instruction_names.h"
+
+void retire_print_record(FILE* fp, const RetireRecord* record)
+{
+    char opcode[8];
+    if(record->extended_opcode >= 0x200)
+        snprintf(opcode, sizeof(opcode), "CF %02X", record->extended_opcode & 0xFF);
+    else if(record->extended_opcode >= 0x100)
+        snprintf(opcode, sizeof(opcode), "CE %02X", record->extended_opcode & 0xFF);
+    else
+        snprintf(opcode, sizeof(opcode), "%02X", record->extended_opcode);
+
+    const char* name = (record->extended_opcode < 0x300)? instruction_names[record->extended_opcode]: nullptr;
+
+    // SC: I1 I0 U D N V C Z
+    char flags[9] = "ZCVNDU01";
+    for(int i = 0; i < 6; ++i)
+        if(!((record->SC >> i) & 1)) flags[i] = '.';
+    flags[6] = '0' + ((record->SC >> 6) & 3);
+    flags[7] = 0;
+
+    fprintf(fp, "%12llu %02X:%04X  %-5s  %-24s %2u  BA=%04X HL=%04X IX=%04X IY=%04X SP=%04X PC=%04X BR=%02X EP=%02X XP=%02X YP=%02X NB=%02X SC=%02X %s\n",
+        (unsigned long long)record->cycle,
+        record->CB, record->top_address,
+        opcode,
+        name? name: "?",
+        record->num_cycles,
+        record->BA, record->HL, record->IX, record->IY, record->SP, record->PC,
+        record->BR, record->EP, record->XP, record->YP, record->NB, record->SC,
+        flags);
+}
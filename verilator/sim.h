@@ -0,0 +1,1519 @@
+// Simulation core shared by the Vminx harnesses: loads the bios and
+// cartridge, clocks the model and services its memory bus. Anything
+// related to presenting the output (SDL, PNG, etc.) stays in the mains.
+// Internal signals accessed through rootp must be listed in minx_public.vlt.
+#pragma once
+
+#include "Vminx.h"
+#include "Vminx___024root.h"
+#include "verilated.h"
+
+// Traced builds define VM_TRACE, plus VM_TRACE_FST when built with
+// --trace-fst. Recent verilator versions also define VM_TRACE_VCD and can
+// build both formats into one model; older ones only one at a time.
+#if VM_TRACE
+#ifndef VM_TRACE_FST
+#define VM_TRACE_FST 0
+#endif
+#ifndef VM_TRACE_VCD
+#define VM_TRACE_VCD !VM_TRACE_FST
+#endif
+#else
+#undef VM_TRACE_FST
+#undef VM_TRACE_VCD
+#define VM_TRACE_FST 0
+#define VM_TRACE_VCD 0
+#endif
+
+#if VM_TRACE_VCD
+#include "verilated_vcd_c.h"
+#endif
+
+// VCD dumps are written to disk by a thread of their own, see
+// trace_writer.h. Build with -DSIM_ASYNC_TRACE=0 to write them on the
+// simulation thread.
+#ifndef SIM_ASYNC_TRACE
+#define SIM_ASYNC_TRACE 1
+#endif
+#if VM_TRACE_VCD && SIM_ASYNC_TRACE
+#include "trace_writer.h"
+#endif
+#if VM_TRACE_FST
+#include "verilated_fst_c.h"
+#endif
+
+// Default trace file, in the preferred format the build supports.
+#if VM_TRACE_FST
+#define SIM_DUMP_FILEPATH "sim.fst"
+#else
+#define SIM_DUMP_FILEPATH "sim.vcd"
+#endif
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <ctime>
+#include <string>
+
+#include "instruction_cycles.h"
+#include "flight_recorder.h"
+#include "trace_trigger.h"
+#include "retire_log.h"
+#include "bus_log.h"
+#include "frame_log.h"
+#include "movie.h"
+#include "eeprom_file.h"
+
+#ifndef VERBOSE
+#define VERBOSE 1
+#endif
+
+#if VERBOSE == 0
+#define PRINTE(...) do{ } while ( false )
+#define PRINTD(...) do{ } while ( false )
+#elif VERBOSE == 1
+#define PRINTE(...) do{ fprintf( stderr, __VA_ARGS__ ); } while( false )
+#define PRINTD(...) do{ } while ( false )
+#else
+#define PRINTE(...) do{ fprintf( stderr, __VA_ARGS__ ); } while( false )
+#define PRINTD(...) do{ fprintf( stdout, __VA_ARGS__ ); } while( false )
+#endif
+
+
+enum
+{
+    BUS_IDLE      = 0x0,
+    BUS_IRQ_READ  = 0x1,
+    BUS_MEM_WRITE = 0x2,
+    BUS_MEM_READ  = 0x3
+};
+
+// OSC3 (4MHz, clk) and OSC1 (32768Hz, clk_rt) edges are scheduled on a
+// common time base in which both half periods are whole numbers, so neither
+// clock accumulates phase error: 1024000000 = lcm(2 * 4000000, 2 * 32768).
+#define SIM_TICKS_PER_SECOND 1024000000ULL
+#define OSC3_HALF_PERIOD (SIM_TICKS_PER_SECOND / (2 * 4000000))
+#define OSC1_HALF_PERIOD (SIM_TICKS_PER_SECOND / (2 * 32768))
+
+// The 24 bit address space is split into 256 byte pages. Each page points
+// straight at the memory backing it, so a bus cycle is served with a single
+// indexed load. Pages that can't be written to point their write side at a
+// scratch page.
+#define SIM_PAGE_SHIFT 8
+#define SIM_NUM_PAGES (1 << (24 - SIM_PAGE_SHIFT))
+
+struct SimPage
+{
+    const uint8_t* read;
+    uint8_t* write;
+};
+
+struct SimData;
+typedef void (*SimBusHandler)(SimData* sim, uint32_t address);
+
+// A bios or cartridge image. Images are read only once loaded, so several
+// SimData instances can share them, see sim_init_shared().
+struct SimImage
+{
+    uint8_t* data;
+    size_t size;
+};
+
+// Dump started and stopped by trigger expressions, see
+// sim_set_trace_window().
+struct SimTraceWindow
+{
+    TraceTrigger start;
+    TraceTrigger stop;
+    bool has_stop;
+
+    // Number of cycles to dump if there is no stop trigger, 0 to dump
+    // until the end.
+    uint64_t num_cycles;
+    uint64_t stop_timestamp;
+
+    const char* filepath;
+    bool done;
+};
+
+struct SimData
+{
+    // Each instance has its own context, so instances can run on separate
+    // threads.
+    VerilatedContext* context;
+    Vminx* minx;
+#if VM_TRACE_VCD
+    VerilatedVcdC* tfp;
+#if SIM_ASYNC_TRACE
+    SimTraceWriter* tfp_writer;
+#endif
+#endif
+#if VM_TRACE_FST
+    VerilatedFstC* fst;
+#endif
+    // Filter file of the hierarchy prefixes to trace, see
+    // sim_apply_trace_filter(). Everything is traced if null.
+    const char* trace_filter;
+    SimTraceWindow* trace_window;
+
+    // Number of OSC3 half cycles simulated so far.
+    uint64_t timestamp;
+
+    // Exact simulation time and the next edge of each oscillator, in ticks
+    // of SIM_TICKS_PER_SECOND.
+    uint64_t time;
+    uint64_t osc1_next_edge;
+    uint64_t osc3_next_edge;
+
+    // Skip over stretches where the cpu is halted and the peripherals are
+    // idle, see sim_fast_forward().
+    bool fast_forward;
+
+    // Performance counters, reported by minx_bench.
+    uint64_t num_evals;
+    uint64_t cycles_skipped;
+    uint32_t frame_count;
+
+    const uint8_t* bios;
+    uint8_t* memory;
+    const uint8_t* cartridge;
+
+    size_t bios_file_size;
+    size_t cartridge_file_size;
+
+    // Images loaded by sim_init(), freed by sim_destroy(). Empty when the
+    // images are shared.
+    SimImage own_bios;
+    SimImage own_cartridge;
+
+    SimPage* pages;
+    uint8_t  write_discard[1 << SIM_PAGE_SHIFT];
+
+    // Called on every memory read if set, see sim_enable_coverage().
+    SimBusHandler on_read;
+
+    uint8_t* bios_touched;
+    uint8_t* cartridge_touched;
+    uint8_t* instructions_executed;
+
+    // Keeps the last cycles in memory and dumps them when ChecksValidate
+    // finds an error, see sim_enable_flight_recorder().
+    FlightRecorder* recorder;
+
+    // Record of every instruction retired while running with
+    // ChecksValidate, see sim_enable_retire_log().
+    RetireLog* retire_log;
+
+    // Record of every bus transaction serviced by simulate_steps(), see
+    // sim_enable_bus_log().
+    BusLog* bus_log;
+
+    // Every captured frame, see sim_enable_frame_log().
+    FILE* frame_log;
+
+    // Input movie being recorded or replayed, see sim_record_movie().
+    Movie* movie;
+
+    // Wall clock time the run started at. The eeprom clock is set from it
+    // (see sim_load_eeprom()) and movies record it, so replays boot to the
+    // same date. It is the time of sim_init() unless fixed with
+    // sim_set_start_time(), in which case the boot cache keys on it too.
+    int64_t start_time;
+    bool start_time_fixed;
+
+    // File the eeprom is kept in, see sim_open_eeprom().
+    EepromFile* eeprom_file;
+    bool eeprom_we_old;
+
+    uint8_t fb_write_index;
+    uint8_t framebuffers[768*8];
+
+    // Harness state.
+    bool data_sent;
+    bool irq_processing;
+    int irq_copy_complete_old;
+    int num_cycles_since_sync;
+    int reset_counter;
+};
+
+struct AudioBuffer
+{
+    uint8_t* data;
+    size_t size;
+    size_t read_position;
+};
+
+void sim_build_page_table(SimData* sim)
+{
+    for(uint32_t page = 0; page < SIM_NUM_PAGES; ++page)
+    {
+        uint32_t address = page << SIM_PAGE_SHIFT;
+        SimPage* entry = &sim->pages[page];
+        if(address < 0x1000)
+        {
+            // bios, mirrored over the first 4KB.
+            entry->read  = sim->bios + address;
+            entry->write = sim->write_discard;
+        }
+        else if(address < 0x2000)
+        {
+            // ram
+            entry->read  = sim->memory + (address & 0xFFF);
+            entry->write = sim->memory + (address & 0xFFF);
+        }
+        else
+        {
+            // cartridge, mirrored every 2MB. Reads from the registers at
+            // 0x2000-0x20FF end up here too, but the model replaces those
+            // with its own data.
+            entry->read  = sim->cartridge + (address & 0x1FFFFF);
+            entry->write = sim->write_discard;
+        }
+    }
+}
+
+// Loads an image into a zeroed buffer of buffer_size bytes; larger files
+// are truncated.
+bool sim_load_image(SimImage* image, const char* filepath, size_t buffer_size)
+{
+    FILE* fp = fopen(filepath, "rb");
+    if(!fp)
+    {
+        image->data = nullptr;
+        image->size = 0;
+        return false;
+    }
+    fseek(fp, 0, SEEK_END);
+    image->size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);  /* same as rewind(f); */
+    if(image->size > buffer_size) image->size = buffer_size;
+
+    image->data = (uint8_t*) calloc(1, buffer_size);
+    fread(image->data, 1, image->size, fp);
+    fclose(fp);
+
+    return true;
+}
+
+void sim_free_image(SimImage* image)
+{
+    free(image->data);
+    image->data = nullptr;
+    image->size = 0;
+}
+
+bool sim_load_bios(SimImage* bios, const char* filepath)
+{
+    if(!sim_load_image(bios, filepath, 0x1000))
+    {
+        PRINTE("Error opening bios %s.\n", filepath);
+        return false;
+    }
+
+    // Mirror smaller bios images over the whole bios area.
+    for(size_t i = bios->size; bios->size > 0 && i < 0x1000; ++i)
+        bios->data[i] = bios->data[i & (bios->size - 1)];
+
+    return true;
+}
+
+bool sim_load_cartridge(SimImage* cartridge, const char* filepath)
+{
+    if(!sim_load_image(cartridge, filepath, 0x200000))
+    {
+        PRINTE("Error opening cartridge %s.\n", filepath);
+        return false;
+    }
+
+    return true;
+}
+
+// 64 bit FNV-1a hash of an image, identifies the bios and cartridge that
+// save states and movies belong to.
+uint64_t sim_hash_image(const uint8_t* data, size_t size)
+{
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    for(size_t i = 0; i < size; ++i)
+    {
+        hash ^= data[i];
+        hash *= 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+// Sets up an instance running the given images, which are not copied and
+// must outlive it.
+bool sim_init_shared(SimData* sim, const SimImage* bios, const SimImage* cartridge)
+{
+    sim->bios                = bios->data;
+    sim->bios_file_size      = bios->size;
+    sim->cartridge           = cartridge->data;
+    sim->cartridge_file_size = cartridge->size;
+
+    sim->own_bios      = SimImage{nullptr, 0};
+    sim->own_cartridge = SimImage{nullptr, 0};
+
+    sim->bios_touched = (uint8_t*) calloc(sim->bios_file_size, 1);
+    sim->memory = (uint8_t*) calloc(1, 4*1024);
+    sim->cartridge_touched = (uint8_t*) calloc(1, sim->cartridge_file_size);
+    sim->instructions_executed = (uint8_t*) calloc(1, 0x300);
+
+    sim->pages = (SimPage*) malloc(SIM_NUM_PAGES * sizeof(SimPage));
+    sim_build_page_table(sim);
+    sim->on_read = nullptr;
+    sim->recorder = nullptr;
+    sim->retire_log = nullptr;
+    sim->bus_log = nullptr;
+    sim->frame_log = nullptr;
+    sim->movie = nullptr;
+    sim->start_time = (int64_t)time(NULL);
+    sim->start_time_fixed = false;
+    sim->eeprom_file = nullptr;
+    sim->eeprom_we_old = false;
+
+    sim->fb_write_index = 0;
+    memset(sim->framebuffers, 0x0, 8*768);
+
+    sim->context = new VerilatedContext;
+    sim->minx = new Vminx(sim->context);
+    sim->minx->clk = 0;
+    sim->minx->reset = 1;
+    sim->minx->clk_ce_4mhz = 1;
+    sim->minx->eeprom_we = 0;
+
+    sim->time           = 0;
+    sim->osc3_next_edge = 0;
+    sim->osc1_next_edge = OSC1_HALF_PERIOD;
+
+    sim->fast_forward = false;
+
+    sim->timestamp      = 0;
+    sim->num_evals      = 0;
+    sim->cycles_skipped = 0;
+    sim->frame_count    = 0;
+
+    sim->data_sent             = false;
+    sim->irq_processing        = false;
+    sim->irq_copy_complete_old = 0;
+    sim->num_cycles_since_sync = 0;
+    sim->reset_counter         = 0;
+
+#if VM_TRACE
+    sim->context->traceEverOn(true);
+#endif
+    sim->trace_filter = nullptr;
+    sim->trace_window = nullptr;
+#if VM_TRACE_VCD
+    sim->tfp = nullptr;
+#if SIM_ASYNC_TRACE
+    sim->tfp_writer = nullptr;
+#endif
+#endif
+#if VM_TRACE_FST
+    sim->fst = nullptr;
+#endif
+
+    sim->minx->clk_rt_ce = 1;
+
+    return true;
+}
+
+bool sim_init(SimData* sim, const char* cartridge_path)
+{
+    SimImage bios, cartridge;
+    if(!sim_load_bios(&bios, "data/bios.min"))
+        return false;
+
+    if(!sim_load_cartridge(&cartridge, cartridge_path))
+    {
+        sim_free_image(&bios);
+        return false;
+    }
+
+    sim_init_shared(sim, &bios, &cartridge);
+    sim->own_bios      = bios;
+    sim->own_cartridge = cartridge;
+
+    return true;
+}
+
+void sim_dump_eeprom(SimData* sim, const char* filepath)
+{
+    VlUnpacked<unsigned char, 8192> rom = sim->minx->rootp->minx__DOT__eeprom__DOT__rom;
+    const uint8_t* data = rom.m_storage;
+    FILE* fp = fopen(filepath, "wb");
+    {
+        fwrite(data, 1, 8192, fp);
+    }
+    fclose(fp);
+}
+
+#define SIM_EEPROM_FLUSH_FRAMES 64
+
+// Keeps the eeprom in the given file, like the autosave of the core
+// (status[11]). The eeprom is loaded from the file, or the file is filled
+// with the eeprom if it is new. From then on the file follows every write
+// of the cpu to the eeprom, see simulate_steps(), and is flushed every
+// SIM_EEPROM_FLUSH_FRAMES frames and by sim_destroy().
+//
+// Anything else that changes the eeprom, like the clock set by
+// sim_load_eeprom() or loading a save state, reaches the file at the next
+// flush.
+bool sim_open_eeprom(SimData* sim, const char* filepath)
+{
+    bool is_new;
+    EepromFile* file = eeprom_file_open(filepath, &is_new);
+    if(!file)
+        return false;
+
+    uint8_t* eeprom = sim->minx->rootp->minx__DOT__eeprom__DOT__rom.m_storage;
+    if(is_new)
+        eeprom_file_update(file, eeprom);
+    else
+        memcpy(eeprom, file->data, EEPROM_FILE_SIZE);
+
+    if(sim->eeprom_file)
+        eeprom_file_close(sim->eeprom_file);
+    sim->eeprom_file = file;
+    return true;
+}
+
+static inline bool sim_is_dumping(const SimData* sim)
+{
+#if VM_TRACE_VCD
+    if(sim->tfp) return true;
+#endif
+#if VM_TRACE_FST
+    if(sim->fst) return true;
+#endif
+    return false;
+}
+
+#if VM_TRACE
+// Restricts a trace to the hierarchy prefixes listed in a filter file, one
+// per line, e.g.
+//
+//   # cpu and the PRC state machine only
+//   minx.cpu.*
+//   minx.prc.state
+//
+// A trailing ".*" is optional. Signals outside the listed scopes are not
+// declared in the dump and not sampled. Returns the number of prefixes, 0
+// (everything is traced) if the file can't be read or lists none.
+template<typename TraceFile>
+int sim_apply_trace_filter(TraceFile* trace_file, const char* filter_filepath)
+{
+    FILE* fp = fopen(filter_filepath, "r");
+    if(!fp)
+    {
+        PRINTE("Error opening trace filter %s, tracing everything.\n", filter_filepath);
+        return 0;
+    }
+
+    int num_prefixes = 0;
+    char line[256];
+    while(fgets(line, sizeof(line), fp))
+    {
+        char* prefix = line;
+        while(*prefix == ' ' || *prefix == '\t') ++prefix;
+
+        size_t length = strcspn(prefix, "# \t\r\n");
+        prefix[length] = 0;
+        if(length >= 2 && strcmp(prefix + length - 2, ".*") == 0)
+            prefix[length -= 2] = 0;
+        if(length == 0) continue;
+
+        // Verilator names the scopes after the model instance, TOP.
+        std::string hierarchy = strncmp(prefix, "TOP.", 4) == 0? prefix: std::string("TOP.") + prefix;
+        trace_file->dumpvars(99, hierarchy);
+        ++num_prefixes;
+    }
+    fclose(fp);
+
+    return num_prefixes;
+}
+
+void sim_dump_stop(SimData* sim)
+{
+    if(!sim_is_dumping(sim)) return;
+    printf("Stopping dump.\n");
+
+#if VM_TRACE_VCD
+    if(sim->tfp)
+    {
+        sim->tfp->close();
+        delete sim->tfp;
+        sim->tfp = nullptr;
+#if SIM_ASYNC_TRACE
+        delete sim->tfp_writer;
+        sim->tfp_writer = nullptr;
+#endif
+    }
+#endif
+#if VM_TRACE_FST
+    if(sim->fst)
+    {
+        sim->fst->close();
+        delete sim->fst;
+        sim->fst = nullptr;
+    }
+#endif
+}
+
+// The format is picked from the file extension: .fst for FST, anything else
+// for VCD. If the build doesn't support the requested format the other one
+// is written instead, to the same path.
+void sim_dump_start(SimData* sim, const char* filepath)
+{
+    printf("Starting dump at timestamp: %llu.\n", sim->timestamp);
+    if(sim_is_dumping(sim))
+        sim_dump_stop(sim);
+
+    size_t length = strlen(filepath);
+    bool fst = length >= 4 && strcmp(filepath + length - 4, ".fst") == 0;
+
+#if VM_TRACE_FST && VM_TRACE_VCD
+    if(fst)
+#elif VM_TRACE_FST
+    if(!fst)
+        PRINTE("Built without VCD support, writing FST to %s.\n", filepath);
+#else
+    if(fst)
+        PRINTE("Built without FST support, writing VCD to %s.\n", filepath);
+#endif
+
+#if VM_TRACE_FST
+    {
+        sim->fst = new VerilatedFstC;
+        if(sim->trace_filter)
+            sim_apply_trace_filter(sim->fst, sim->trace_filter);
+        sim->minx->trace(sim->fst, 99);  // Trace 99 levels of hierarchy
+        sim->fst->open(filepath);
+        return;
+    }
+#endif
+#if VM_TRACE_VCD
+#if SIM_ASYNC_TRACE
+    sim->tfp_writer = new SimTraceWriter;
+    sim->tfp = new VerilatedVcdC(sim->tfp_writer);
+#else
+    sim->tfp = new VerilatedVcdC;
+#endif
+    if(sim->trace_filter)
+        sim_apply_trace_filter(sim->tfp, sim->trace_filter);
+    sim->minx->trace(sim->tfp, 99);  // Trace 99 levels of hierarchy
+    //sim->tfp->rolloverMB(209715200);
+    sim->tfp->open(filepath);
+#endif
+}
+#else
+void sim_dump_stop(SimData* sim) {}
+
+void sim_dump_start(SimData* sim, const char* filepath)
+{
+    PRINTE("Built without -trace, not dumping to %s.\n", filepath);
+}
+#endif
+
+void sim_destroy(SimData* sim)
+{
+    sim_dump_stop(sim);
+    if(sim->recorder)
+    {
+        flight_recorder_destroy(sim->recorder);
+        sim->recorder = nullptr;
+    }
+    free(sim->trace_window);
+    sim->trace_window = nullptr;
+    if(sim->retire_log)
+    {
+        retire_log_close(sim->retire_log);
+        sim->retire_log = nullptr;
+    }
+    if(sim->bus_log)
+    {
+        bus_log_close(sim->bus_log);
+        sim->bus_log = nullptr;
+    }
+    if(sim->frame_log)
+    {
+        fclose(sim->frame_log);
+        sim->frame_log = nullptr;
+    }
+    if(sim->movie)
+    {
+        movie_close(sim->movie);
+        sim->movie = nullptr;
+    }
+    if(sim->eeprom_file)
+    {
+        eeprom_file_update(sim->eeprom_file, sim->minx->rootp->minx__DOT__eeprom__DOT__rom.m_storage);
+        eeprom_file_close(sim->eeprom_file);
+        sim->eeprom_file = nullptr;
+    }
+
+    sim->minx->final();
+    delete sim->minx;
+    sim->minx = nullptr;
+    delete sim->context;
+    sim->context = nullptr;
+
+    sim_free_image(&sim->own_bios);
+    sim_free_image(&sim->own_cartridge);
+    free(sim->bios_touched);
+    free(sim->memory);
+    free(sim->cartridge_touched);
+    free(sim->instructions_executed);
+    free(sim->pages);
+}
+
+void sim_coverage_read(SimData* sim, uint32_t address)
+{
+    if(address < 0x1000)
+        sim->bios_touched[address & (sim->bios_file_size - 1)] = 1;
+    else if(address >= 0x2000)
+        sim->cartridge_touched[(address & 0x1FFFFF) & (sim->cartridge_file_size - 1)] = 1;
+}
+
+// Tracks which bytes of the bios and cartridge are read, into bios_touched
+// and cartridge_touched.
+void sim_enable_coverage(SimData* sim)
+{
+    sim->on_read = sim_coverage_read;
+}
+
+// Signals kept by the flight recorder, in the order sim_flight_record()
+// stores them.
+static const FlightSignal sim_flight_signals[] = {
+    {"address_out", 24},
+    {"data_in", 8},
+    {"data_out", 8},
+    {"bus_status", 2},
+    {"read", 1},
+    {"write", 1},
+    {"sync", 1},
+    {"pl", 1},
+    {"pk", 1},
+    {"iack", 1},
+    {"bus_request", 1},
+    {"bus_ack", 1},
+    {"clk_ce", 1},
+    {"cpu_state", 3},
+    {"cpu_microaddress", 11},
+    {"cpu_micro_op", 36},
+    {"cpu_extended_opcode", 10},
+    {"cpu_top_address", 16},
+    {"cpu_PC", 16},
+    {"cpu_SP", 16},
+    {"cpu_BA", 16},
+    {"cpu_HL", 16},
+    {"cpu_IX", 16},
+    {"cpu_IY", 16},
+};
+
+static inline void sim_flight_record(SimData* sim)
+{
+    uint64_t* row = flight_recorder_next(sim->recorder, sim->timestamp);
+    row[0]  = sim->minx->address_out;
+    row[1]  = sim->minx->data_in;
+    row[2]  = sim->minx->data_out;
+    row[3]  = sim->minx->bus_status;
+    row[4]  = sim->minx->read;
+    row[5]  = sim->minx->write;
+    row[6]  = sim->minx->sync;
+    row[7]  = sim->minx->pl;
+    row[8]  = sim->minx->pk;
+    row[9]  = sim->minx->iack;
+    row[10] = sim->minx->bus_request;
+    row[11] = sim->minx->bus_ack;
+    row[12] = sim->minx->rootp->minx__DOT__clk_ce;
+    row[13] = sim->minx->rootp->minx__DOT__cpu__DOT__state;
+    row[14] = sim->minx->rootp->minx__DOT__cpu__DOT__microaddress;
+    row[15] = sim->minx->rootp->minx__DOT__cpu__DOT__micro_op;
+    row[16] = sim->minx->rootp->minx__DOT__cpu__DOT__extended_opcode;
+    row[17] = sim->minx->rootp->minx__DOT__cpu__DOT__top_address;
+    row[18] = sim->minx->rootp->minx__DOT__cpu__DOT__PC;
+    row[19] = sim->minx->rootp->minx__DOT__cpu__DOT__SP;
+    row[20] = sim->minx->rootp->minx__DOT__cpu__DOT__BA;
+    row[21] = sim->minx->rootp->minx__DOT__cpu__DOT__HL;
+    row[22] = sim->minx->rootp->minx__DOT__cpu__DOT__IX;
+    row[23] = sim->minx->rootp->minx__DOT__cpu__DOT__IY;
+}
+
+// Records the last num_cycles cycles of the bus and cpu state while running
+// with ChecksValidate. When a check fails, post_trigger more cycles are
+// recorded and the buffer is written to <filepath>_000.vcd. Works without
+// -trace, at a fraction of the cost of a full dump.
+void sim_enable_flight_recorder(SimData* sim, uint32_t num_cycles, uint32_t post_trigger, const char* filepath)
+{
+    if(sim->recorder)
+        flight_recorder_destroy(sim->recorder);
+    sim->recorder = flight_recorder_create(sim_flight_signals, sizeof(sim_flight_signals) / sizeof(sim_flight_signals[0]), num_cycles, post_trigger, filepath);
+}
+
+static inline void sim_flight_trigger(SimData* sim, const char* reason)
+{
+    if(sim->recorder)
+        flight_recorder_trigger(sim->recorder, sim->timestamp, reason);
+}
+
+// Writes a record of every instruction the cpu retires to filepath while
+// running with ChecksValidate, LZ4 compressed if it ends in .lz4. See
+// retire_log.h.
+bool sim_enable_retire_log(SimData* sim, const char* filepath)
+{
+    RetireLog* log = retire_log_open(filepath);
+    if(!log) return false;
+
+    if(sim->retire_log)
+        retire_log_close(sim->retire_log);
+    sim->retire_log = log;
+    return true;
+}
+
+static inline void sim_log_retire(SimData* sim, uint16_t extended_opcode, uint8_t num_cycles)
+{
+    RetireRecord* record = retire_log_next(sim->retire_log);
+    record->cycle           = sim->timestamp / 2;
+    record->top_address     = sim->minx->rootp->minx__DOT__cpu__DOT__top_address;
+    record->extended_opcode = extended_opcode;
+    record->PC = sim->minx->rootp->minx__DOT__cpu__DOT__PC;
+    record->SP = sim->minx->rootp->minx__DOT__cpu__DOT__SP;
+    record->BA = sim->minx->rootp->minx__DOT__cpu__DOT__BA;
+    record->HL = sim->minx->rootp->minx__DOT__cpu__DOT__HL;
+    record->IX = sim->minx->rootp->minx__DOT__cpu__DOT__IX;
+    record->IY = sim->minx->rootp->minx__DOT__cpu__DOT__IY;
+    record->SC = sim->minx->rootp->minx__DOT__cpu__DOT__SC;
+    record->CB = sim->minx->rootp->minx__DOT__cpu__DOT__CB;
+    record->NB = sim->minx->rootp->minx__DOT__cpu__DOT__NB;
+    record->EP = sim->minx->rootp->minx__DOT__cpu__DOT__EP;
+    record->XP = sim->minx->rootp->minx__DOT__cpu__DOT__XP;
+    record->YP = sim->minx->rootp->minx__DOT__cpu__DOT__YP;
+    record->BR = sim->minx->rootp->minx__DOT__cpu__DOT__BR;
+    record->num_cycles = num_cycles;
+}
+
+// Appends every memory read and write serviced by simulate_steps() to
+// filepath, see bus_log.h. Works with either Checks policy.
+bool sim_enable_bus_log(SimData* sim, const char* filepath)
+{
+    BusLog* log = bus_log_open(filepath);
+    if(!log) return false;
+
+    if(sim->bus_log)
+        bus_log_close(sim->bus_log);
+    sim->bus_log = log;
+    return true;
+}
+
+static inline void sim_log_bus(SimData* sim, uint32_t address, uint8_t data, uint8_t flags)
+{
+    if(sim->minx->bus_ack) flags |= BUS_LOG_PRC;
+    bus_log_append(sim->bus_log, sim->timestamp / 2, address, data, sim->minx->rootp->minx__DOT__cpu__DOT__top_address, flags);
+}
+
+// Appends every frame captured by simulate_steps() to filepath, see
+// frame_log.h.
+bool sim_enable_frame_log(SimData* sim, const char* filepath)
+{
+    FILE* fp = frame_log_open(filepath);
+    if(!fp) return false;
+
+    if(sim->frame_log)
+        fclose(sim->frame_log);
+    sim->frame_log = fp;
+    return true;
+}
+
+// Sets the wall clock time the run starts at, before the boot, so the
+// eeprom clock and everything the cartridge derives from it is the same
+// in every run.
+void sim_set_start_time(SimData* sim, int64_t start_time)
+{
+    sim->start_time       = start_time;
+    sim->start_time_fixed = true;
+}
+
+// Records every change of the inputs made through sim_set_keys() and
+// sim_reset() from the current cycle on, see movie.h.
+bool sim_record_movie(SimData* sim, const char* filepath)
+{
+    Movie* movie = movie_create(filepath, sim->timestamp / 2, sim_hash_image(sim->cartridge, sim->cartridge_file_size), sim->start_time);
+    if(!movie) return false;
+
+    if(sim->movie)
+        movie_close(sim->movie);
+    sim->movie = movie;
+    movie_append(movie, sim->timestamp / 2, sim->minx->keys_active, 0);
+    return true;
+}
+
+// Replays a movie from the current cycle, which must be the one it was
+// recorded from. The inputs are applied by simulate_steps() on the cycles
+// they were recorded on.
+bool sim_replay_movie(SimData* sim, const char* filepath)
+{
+    Movie* movie = movie_open(filepath);
+    if(!movie) return false;
+
+    if(movie->header.cartridge_hash != sim_hash_image(sim->cartridge, sim->cartridge_file_size))
+    {
+        PRINTE("%s was recorded with a different cartridge.\n", filepath);
+        movie_close(movie);
+        return false;
+    }
+    if(movie->header.start_cycle != sim->timestamp / 2)
+    {
+        PRINTE("%s starts at cycle %llu, not %llu.\n", filepath, (unsigned long long)movie->header.start_cycle, (unsigned long long)(sim->timestamp / 2));
+        movie_close(movie);
+        return false;
+    }
+
+    if(sim->movie)
+        movie_close(sim->movie);
+    sim->movie = movie;
+    sim_set_start_time(sim, movie->header.start_time);
+    return true;
+}
+
+static inline bool sim_is_replaying(const SimData* sim)
+{
+    return sim->movie && !sim->movie->fp;
+}
+
+// Stops recording or replaying, e.g. when the machine is moved to another
+// point in time.
+void sim_stop_movie(SimData* sim)
+{
+    if(!sim->movie) return;
+    PRINTE("Movie %s stopped at cycle %llu.\n", sim->movie->fp? "recording": "replay", (unsigned long long)(sim->timestamp / 2));
+    movie_close(sim->movie);
+    sim->movie = nullptr;
+}
+
+void sim_set_keys(SimData* sim, uint16_t keys)
+{
+    if(keys == sim->minx->keys_active) return;
+    sim->minx->keys_active = keys;
+    if(sim->movie && sim->movie->fp)
+        movie_append(sim->movie, sim->timestamp / 2, keys, 0);
+}
+
+void sim_reset(SimData* sim)
+{
+    sim->minx->reset = 1;
+    if(sim->movie && sim->movie->fp)
+        movie_append(sim->movie, sim->timestamp / 2, sim->minx->keys_active, MOVIE_RESET);
+}
+
+// Applies the replayed inputs due on the current cycle.
+static inline void sim_movie_step(SimData* sim)
+{
+    Movie* movie = sim->movie;
+    uint64_t cycle = sim->timestamp / 2;
+    while(movie->next < movie->num_events && movie->events[movie->next].cycle <= cycle)
+    {
+        const MovieEvent* event = &movie->events[movie->next++];
+        sim->minx->keys_active = event->keys;
+        if(event->flags & MOVIE_RESET)
+            sim->minx->reset = 1;
+    }
+}
+
+// Cycles until the next replayed input, at most max_cycles.
+static inline uint32_t sim_movie_cycles_left(const SimData* sim, uint32_t max_cycles)
+{
+    const Movie* movie = sim->movie;
+    if(!sim_is_replaying(sim) || movie->next >= movie->num_events)
+        return max_cycles;
+    uint64_t num_cycles = movie->events[movie->next].cycle - sim->timestamp / 2;
+    return (num_cycles < max_cycles)? (uint32_t)num_cycles: max_cycles;
+}
+
+// Dumps to filepath from the cycle the start expression fires until the
+// stop expression fires, or for num_cycles cycles if there is no stop
+// expression (or until the end if num_cycles is 0 too). See
+// trace_trigger.h for the expressions. Only one window is dumped.
+bool sim_set_trace_window(SimData* sim, const char* start, const char* stop, uint64_t num_cycles, const char* filepath)
+{
+    SimTraceWindow* window = (SimTraceWindow*) calloc(1, sizeof(SimTraceWindow));
+    if(!trace_trigger_parse(&window->start, start) || (stop && !trace_trigger_parse(&window->stop, stop)))
+    {
+        free(window);
+        return false;
+    }
+    window->has_stop   = stop != nullptr;
+    window->num_cycles = num_cycles;
+    window->filepath   = filepath;
+
+    free(sim->trace_window);
+    sim->trace_window = window;
+    return true;
+}
+
+static void sim_trace_window_step(SimData* sim)
+{
+    SimTraceWindow* window = sim->trace_window;
+    if(window->done) return;
+
+    TriggerSample sample;
+    sample.frame     = sim->frame_count;
+    sample.timestamp = sim->timestamp;
+    sample.address   = sim->minx->address_out & 0xFFFFFF;
+    sample.read      = sim->minx->bus_status == BUS_MEM_READ && sim->minx->pl == 0;
+    sample.fetch     = sample.read && sim->minx->sync;
+    sample.write     = sim->minx->bus_status == BUS_MEM_WRITE && sim->minx->write;
+    sample.irq       = (sim->minx->rootp->minx__DOT__cpu__DOT__exception_process_step == 5)?
+        sim->minx->rootp->minx__DOT__cpu__DOT__irq_vector_address >> 1: -1;
+
+    if(!sim_is_dumping(sim))
+    {
+        if(trace_trigger_update(&window->start, &sample))
+        {
+            printf("Trace trigger \"%s\" fired.\n", window->start.text);
+            sim_dump_start(sim, window->filepath);
+            window->stop_timestamp = window->num_cycles? sim->timestamp + 2 * window->num_cycles: UINT64_MAX;
+        }
+    }
+    else if((window->has_stop && trace_trigger_update(&window->stop, &sample)) || sim->timestamp >= window->stop_timestamp)
+    {
+        sim_dump_stop(sim);
+        window->done = true;
+    }
+}
+
+static inline void sim_eval(SimData* sim)
+{
+    sim->minx->eval();
+    ++sim->num_evals;
+}
+
+static inline void sim_trace_dump(SimData* sim)
+{
+#if VM_TRACE_VCD
+    if(sim->tfp) sim->tfp->dump(sim->timestamp);
+#endif
+#if VM_TRACE_FST
+    if(sim->fst) sim->fst->dump(sim->timestamp);
+#endif
+}
+
+static inline void sim_clock_osc1_edge(SimData* sim)
+{
+    sim->time = sim->osc1_next_edge;
+    sim->minx->clk_rt = !sim->minx->clk_rt;
+    sim_eval(sim);
+    sim->osc1_next_edge += OSC1_HALF_PERIOD;
+}
+
+// Advances the simulation to the next OSC3 edge and sets clk to the given
+// level. OSC1 edges that fall before it are evaluated on the way, each at
+// its own time, so the model is evaluated exactly once per clock edge.
+static inline void sim_clock_osc3_edge(SimData* sim, uint8_t clk)
+{
+    while(sim->osc1_next_edge < sim->osc3_next_edge)
+        sim_clock_osc1_edge(sim);
+
+    sim->time = sim->osc3_next_edge;
+    sim->minx->clk = clk;
+    sim_eval(sim);
+    sim_trace_dump(sim);
+    sim->osc3_next_edge += OSC3_HALF_PERIOD;
+    sim->timestamp++;
+}
+
+// HALT fast-forward.
+//
+// While the cpu sits in HALT with nothing on the bus, all that changes from
+// one OSC3 cycle to the next are a few free running counters: the PRC line
+// oscillator and cycle counter and the OSC1 prescalers of the timers. If no
+// peripheral can raise an irq in the meantime, those counters can be
+// advanced directly instead of evaluating the model on every clock edge.
+// OSC1 edges are still evaluated as usual, so the rtc and the 256Hz timer
+// keep running.
+//
+// The conditions below are conservative: the 8/16 bit timers have to be
+// stopped, the PRC must not be holding the bus and the skip always ends
+// before the next PRC line or 256Hz timer tick.
+#define STATE_HALT 4
+#define PRC_OSC_STEP 4682
+#define PRC_OSC_LINE 4000000
+
+bool sim_is_idle(SimData* sim)
+{
+    Vminx___024root* rootp = sim->minx->rootp;
+
+    // Keep traces complete.
+    if(sim_is_dumping(sim)) return false;
+
+    if(sim->minx->reset || sim->minx->clk) return false;
+    if(rootp->minx__DOT__cpu__DOT__state != STATE_HALT) return false;
+    if(sim->minx->bus_request || sim->minx->bus_ack || sim->minx->iack) return false;
+    if(sim->minx->read || sim->minx->write || sim->minx->eeprom_internal_we) return false;
+
+    // No irq pending, none in flight.
+    if(rootp->minx__DOT__irq__DOT__reg_irq_active & rootp->minx__DOT__irq__DOT__reg_irq_enabled) return false;
+    if(rootp->minx__DOT__irq_copy_complete || rootp->minx__DOT__irq_render_done) return false;
+    if(rootp->minx__DOT__t1_irqs || rootp->minx__DOT__t2_irqs || rootp->minx__DOT__t3_irqs) return false;
+    if(rootp->minx__DOT__t256_irqs || rootp->minx__DOT__key_irqs) return false;
+    if(rootp->minx__DOT__key_input__DOT__key_latches != sim->minx->keys_active) return false;
+
+    // Timers stopped, with no pending reset.
+    if(rootp->minx__DOT__timer1__DOT__reg_control & 0x0606) return false;
+    if(rootp->minx__DOT__timer2__DOT__reg_control & 0x0606) return false;
+    if(rootp->minx__DOT__timer3__DOT__reg_control & 0x0606) return false;
+    if(rootp->minx__DOT__timer256__DOT__reg_reset || rootp->minx__DOT__rtc__DOT__reg_reset) return false;
+
+    // PRC done with the previous line.
+    if(sim->minx->frame_complete) return false;
+    if(rootp->minx__DOT__prc__DOT__reg_counter != rootp->minx__DOT__prc__DOT__reg_counter_old) return false;
+
+    return true;
+}
+
+// Skips up to max_cycles OSC3 cycles if the simulation is idle. Returns the
+// number of cycles skipped, always a multiple of 4 so that the cpu clock
+// prescaler and the HALT counter end up in the same phase.
+uint32_t sim_fast_forward(SimData* sim, uint32_t max_cycles)
+{
+    if(!sim_is_idle(sim)) return 0;
+
+    Vminx___024root* rootp = sim->minx->rootp;
+
+    // Stop before the PRC line counter changes.
+    int64_t prc_osc_counter = rootp->minx__DOT__prc__DOT__prc_osc_counter;
+    int64_t num_cycles = (PRC_OSC_LINE - 1 - prc_osc_counter) / PRC_OSC_STEP + 1;
+    if(prc_osc_counter >= PRC_OSC_LINE) num_cycles = 0;
+
+    // Stop before the 256Hz timer ticks; it reads the timer1 OSC1 prescaler
+    // on the rising edge of clk_rt.
+    if(rootp->minx__DOT__timer256__DOT__reg_enabled)
+    {
+        uint64_t posedge = sim->osc1_next_edge + (sim->minx->clk_rt? OSC1_HALF_PERIOD: 0);
+        posedge += 2 * OSC1_HALF_PERIOD * ((0x7F - rootp->minx__DOT__timer1__DOT__osc2_prescaler) & 0x7F);
+        if(posedge <= sim->osc3_next_edge) return 0;
+
+        // The last skipped edge must come strictly before the tick.
+        int64_t max_edges = (posedge - sim->osc3_next_edge - 1) / OSC3_HALF_PERIOD + 1;
+        if(max_edges / 2 < num_cycles) num_cycles = max_edges / 2;
+    }
+
+    if(num_cycles > max_cycles) num_cycles = max_cycles;
+    num_cycles &= ~3;
+    if(num_cycles == 0) return 0;
+
+    // The skipped clk edges are at osc3_next_edge + i * OSC3_HALF_PERIOD,
+    // i < 2 * num_cycles. OSC1 edges are evaluated up to and including the
+    // last one, the timers sample clk_rt on the last rising edge of clk.
+    uint64_t last_posedge = sim->osc3_next_edge + (2 * num_cycles - 2) * OSC3_HALF_PERIOD;
+    uint64_t last_edge    = last_posedge + OSC3_HALF_PERIOD;
+    while(sim->osc1_next_edge < last_posedge)
+        sim_clock_osc1_edge(sim);
+
+    uint8_t rt_clk = sim->minx->clk_rt & sim->minx->clk_rt_ce;
+    rootp->minx__DOT__timer1__DOT__rt_clk_latch = rt_clk;
+    rootp->minx__DOT__timer2__DOT__rt_clk_latch = rt_clk;
+    rootp->minx__DOT__timer3__DOT__rt_clk_latch = rt_clk;
+
+    while(sim->osc1_next_edge <= last_edge)
+        sim_clock_osc1_edge(sim);
+
+    // Nothing combinational depends on these, so no eval is needed.
+    rootp->minx__DOT__prc__DOT__prc_osc_counter += PRC_OSC_STEP * num_cycles;
+    rootp->minx__DOT__prc__DOT__cycle_count     += num_cycles;
+    rootp->minx__DOT__timer1__DOT__osc1_prescaler = (rootp->minx__DOT__timer1__DOT__osc1_prescaler + num_cycles) & 0xFFF;
+    rootp->minx__DOT__timer2__DOT__osc1_prescaler = (rootp->minx__DOT__timer2__DOT__osc1_prescaler + num_cycles) & 0xFFF;
+    rootp->minx__DOT__timer3__DOT__osc1_prescaler = (rootp->minx__DOT__timer3__DOT__osc1_prescaler + num_cycles) & 0xFFF;
+
+    sim->time            = last_edge;
+    sim->osc3_next_edge += 2 * num_cycles * OSC3_HALF_PERIOD;
+    sim->timestamp      += 2 * num_cycles;
+    sim->cycles_skipped += num_cycles;
+
+    return num_cycles;
+}
+
+void eeprom_set_timestamp(uint8_t* eeprom, uint8_t year, uint8_t month, uint8_t day, uint8_t hour, uint8_t min, uint8_t sec)
+{
+    if (!eeprom) return;
+    uint8_t checksum = year + month + day + hour + min + sec;
+    eeprom[0x1FF6] = 0x00;
+    eeprom[0x1FF7] = 0x00;
+    eeprom[0x1FF8] = 0x00;
+    eeprom[0x1FF9] = year;
+    eeprom[0x1FFA] = month;
+    eeprom[0x1FFB] = day;
+    eeprom[0x1FFC] = hour;
+    eeprom[0x1FFD] = min;
+    eeprom[0x1FFE] = sec;
+    eeprom[0x1FFF] = checksum;
+}
+
+void sim_load_eeprom(SimData* sim, const char* filepath)
+{
+    // The contents of a saved eeprom are loaded by sim_open_eeprom(), only
+    // the header and the clock are set here.
+    uint8_t* eeprom = sim->minx->rootp->minx__DOT__eeprom__DOT__rom.m_storage;
+    {
+        strncpy((char*)eeprom, "GBMN", 4);
+        eeprom[0x1FF2] = 0x01;
+        eeprom[0x1FF3] = 0x03;
+        eeprom[0x1FF4] = 0x01;
+        eeprom[0x1FF5] = 0x1F;
+    }
+    // @todo: Try initializing just a few required fields, like the GBMN and
+    // see if that's sufficient for accepting the set datetime.
+
+    // The run's start time plus the emulated time, rather than the wall
+    // clock, so that runs are reproducible.
+    // localtime_r() as machines may boot on several threads at once.
+    time_t tim = (time_t)(sim->start_time + sim->timestamp / (2 * 4000000));
+    struct tm now;
+    localtime_r(&tim, &now);
+    eeprom_set_timestamp(eeprom, now.tm_year % 100, now.tm_mon+1, now.tm_mday, now.tm_hour, now.tm_min, now.tm_sec);
+
+    // @note: The commented out part is not required; these already have these values.
+    //sim->minx->rootp->minx__DOT__rtc__DOT__timer = 0;
+    //sim->minx->rootp->minx__DOT__rtc__DOT__reg_enabled = 1;
+    sim->minx->rootp->minx__DOT__system_control__DOT__reg_system_control[2] |= 2;
+}
+
+// Per-cycle diagnostics are selected at compile time by the Checks template
+// parameter of simulate_steps(). ChecksValidate peeks at the cpu internals
+// every cycle to catch unimplemented instructions, cycle count
+// discrepancies and stack overflows; ChecksNone compiles all of that out
+// for long runs of cores that already pass validation.
+struct ChecksValidate
+{
+    // Returns false if the simulation should stop.
+    static bool check_cycle(SimData* sim)
+    {
+        if(sim->recorder)
+        {
+            sim_flight_record(sim);
+            flight_recorder_step(sim->recorder);
+        }
+
+        if(sim->minx->rootp->minx__DOT__irq_copy_complete && sim->irq_copy_complete_old == 0)
+        {
+            sim->irq_copy_complete_old = 1;
+            PRINTD("Copy complete %d.\n", sim->timestamp / 2);
+        }
+        else if(!sim->minx->rootp->minx__DOT__irq_copy_complete) sim->irq_copy_complete_old = 0;
+
+        // Check for errors
+        {
+            if(sim->minx->rootp->minx__DOT__cpu__DOT__state == 2 && sim->minx->pl == 0 && !sim->minx->bus_ack)
+            {
+                if(sim->minx->rootp->minx__DOT__cpu__DOT__microaddress == 0 &&
+                   sim->minx->rootp->minx__DOT__cpu__DOT__extended_opcode != 0x1AE
+                ){
+                    PRINTE("** Instruction 0x%x not implemented at 0x%x, timestamp: %llu**\n", sim->minx->rootp->minx__DOT__cpu__DOT__extended_opcode, sim->minx->rootp->minx__DOT__cpu__DOT__top_address, sim->timestamp);
+                    sim_flight_trigger(sim, "Instruction not implemented");
+                }
+            }
+
+            //if(
+            //    (sim->minx->sync == 1) &&
+            //    (sim->minx->pk == 0) &&
+            //    sim->minx->iack == 0 &&
+            //    sim->minx->rootp->minx__DOT__clk_ce &&
+            //    !sim->minx->bus_ack)
+            //{
+            //    printf("^ 0x%x\n", sim->minx->address_out);
+            //}
+
+            if(
+                (sim->minx->sync == 1) &&
+                (sim->minx->pl == 0) &&
+                (sim->minx->rootp->minx__DOT__cpu__DOT__micro_op & 0x1000) &&
+                sim->minx->iack == 0 &&
+                sim->minx->rootp->minx__DOT__clk_ce &&
+                !sim->minx->bus_ack)
+            {
+                if(sim->irq_processing)
+                    sim->irq_processing = false;
+                else
+                {
+                    uint8_t num_cycles        = sim->num_cycles_since_sync;
+                    uint16_t extended_opcode  = sim->minx->rootp->minx__DOT__cpu__DOT__extended_opcode;
+                    uint8_t num_cycles_actual = instruction_cycles[2*extended_opcode];
+                    uint8_t num_cycles_actual_branch = instruction_cycles[2*extended_opcode+1];
+
+
+                    if(num_cycles != num_cycles_actual)
+                    {
+                        if(num_cycles != num_cycles_actual_branch || num_cycles_actual_branch == 0)
+                        {
+                            PRINTE(" ** Discrepancy found in number of cycles of instruction 0x%x: %d, %d, timestamp: %llu** \n", extended_opcode, num_cycles, num_cycles_actual, sim->timestamp);
+                            sim_flight_trigger(sim, "Cycle count discrepancy");
+                        }
+                    }
+
+                    //if(sim->minx->address_out == 0x4C5C)
+                    //    printf("^ address: 0x%x, A: 0x%x\n", 0x4C5C, sim->minx->rootp->minx__DOT__cpu__DOT__BA & 0xFF);
+
+                    //if(!sim->instructions_executed[extended_opcode])
+                    //    printf("Instruction 0x%x executed for the first time, at 0x%x, timestamp: %llu.\n", extended_opcode, sim->minx->rootp->minx__DOT__cpu__DOT__top_address, sim->timestamp);
+                    sim->instructions_executed[extended_opcode] = 1;
+                    if(sim->retire_log)
+                        sim_log_retire(sim, extended_opcode, num_cycles);
+                }
+            }
+
+            if(sim->minx->rootp->minx__DOT__cpu__DOT__not_implemented_addressing_error == 1)
+            {
+                PRINTE(" ** Addressing not implemented error: 0x%llx, timestamp: %llu** \n", (sim->minx->rootp->minx__DOT__cpu__DOT__micro_op & 0x3F00000) >> 20, sim->timestamp);
+                sim_flight_trigger(sim, "Addressing not implemented");
+            }
+
+            if(sim->minx->rootp->minx__DOT__cpu__DOT__not_implemented_jump_error == 1)
+            {
+                PRINTE(" ** Jump not implemented error, 0x%llx, timestamp: %llu** \n", (sim->minx->rootp->minx__DOT__cpu__DOT__micro_op & 0x7C000) >> 14, sim->timestamp);
+                sim_flight_trigger(sim, "Jump not implemented");
+            }
+
+            if(sim->minx->rootp->minx__DOT__cpu__DOT__not_implemented_data_out_error == 1)
+            {
+                PRINTE(" ** Data-out not implemented error, timestamp: %llu** \n", sim->timestamp);
+                sim_flight_trigger(sim, "Data-out not implemented");
+            }
+
+            if(sim->minx->rootp->minx__DOT__cpu__DOT__not_implemented_mov_src_error == 1)
+            {
+                PRINTE(" ** Mov src not implemented error, timestamp: %llu** \n", sim->timestamp);
+                sim_flight_trigger(sim, "Mov src not implemented");
+            }
+
+            if(sim->minx->rootp->minx__DOT__cpu__DOT__not_implemented_write_error == 1)
+            {
+                PRINTE(" ** Write not implemented error, timestamp: %llu** \n", sim->timestamp);
+                sim_flight_trigger(sim, "Write not implemented");
+            }
+
+            if(sim->minx->rootp->minx__DOT__cpu__DOT__alu_op_error == 1)
+            {
+                PRINTE(" ** Alu not implemented error, timestamp: %llu** \n", sim->timestamp);
+                sim_flight_trigger(sim, "Alu not implemented");
+            }
+
+            if(sim->minx->rootp->minx__DOT__cpu__DOT__not_implemented_alu_pack_ops_error == 1)
+            {
+                PRINTE(" ** Alu packed operations not implemented error, sim->timestamp: %llu, 0x%x** \n", sim->timestamp, sim->minx->rootp->minx__DOT__cpu__DOT__top_address);
+                sim_flight_trigger(sim, "Alu packed operations not implemented");
+            }
+
+            if(sim->minx->rootp->minx__DOT__cpu__DOT__not_implemented_divzero_error == 1)
+            {
+                PRINTE(" ** Division by zero exception not implemented error, sim->timestamp: %llu**\n", sim->timestamp);
+                sim_flight_trigger(sim, "Division by zero exception not implemented");
+            }
+
+            if(sim->minx->rootp->minx__DOT__cpu__DOT__SP > 0x2000 && sim->minx->pl == 0)
+            {
+                PRINTE(" ** Stack overflow, timestamp: %llu**\n", sim->timestamp);
+                sim_flight_trigger(sim, "Stack overflow");
+                return false;
+            }
+        }
+
+        if(sim->timestamp > 258 && sim->minx->iack == 1 && sim->minx->pl == 0)// && sim->minx->sync)
+        {
+            sim->irq_processing = true;
+        }
+
+        if(sim->minx->rootp->minx__DOT__clk_ce)
+        {
+            if(sim->minx->sync && sim->minx->pl == 1)
+                sim->num_cycles_since_sync = 0;
+
+            if(sim->minx->pl == 1 && !sim->minx->bus_ack)
+                ++sim->num_cycles_since_sync;
+        }
+
+        return true;
+    }
+
+    // Accounts for cycles skipped by sim_fast_forward(). The cpu is halted,
+    // so only the cycle counting since the last sync advances.
+    static void skip_cycles(SimData* sim, uint32_t num_cycles)
+    {
+        if(sim->minx->pl == 1 && !sim->minx->bus_ack)
+        {
+            if(sim->minx->sync)
+                sim->num_cycles_since_sync = 1;
+            else
+                sim->num_cycles_since_sync += num_cycles / 2;
+        }
+    }
+};
+
+struct ChecksNone
+{
+    static bool check_cycle(SimData* sim)
+    {
+        return true;
+    }
+
+    static void skip_cycles(SimData* sim, uint32_t num_cycles)
+    {
+    }
+};
+
+// Returns the framebuffer captured for the given frame (counting from 1, as
+// frame_count does), or nullptr if it has already been overwritten.
+const uint8_t* sim_get_frame(const SimData* sim, uint32_t frame)
+{
+    if(frame == 0 || frame > sim->frame_count || frame + 8 <= sim->frame_count)
+        return nullptr;
+    return sim->framebuffers + 768 * ((frame - 1) % 8);
+}
+
+// 64 bit FNV-1a hash of a framebuffer, used to compare runs.
+uint64_t sim_hash_frame(const uint8_t* framebuffer)
+{
+    return sim_hash_image(framebuffer, 768);
+}
+
+template<typename Checks = ChecksValidate>
+void simulate_steps(SimData* sim, int n_steps, AudioBuffer* audio_buffer = nullptr)
+{
+    uint8_t frame_complete_latch = sim->minx->frame_complete;
+    for(int i = 0; i < n_steps && !sim->context->gotFinish(); ++i)
+    {
+        if(sim_is_replaying(sim))
+            sim_movie_step(sim);
+
+        if(sim->fast_forward)
+        {
+            // Replayed inputs must land on their cycle, not after a skip.
+            uint32_t num_skipped = sim_fast_forward(sim, sim_movie_cycles_left(sim, n_steps - i));
+            if(num_skipped > 0)
+            {
+                if(audio_buffer)
+                {
+                    uint8_t volume = sim->minx->sound_volume;
+                    uint8_t multiplier = (volume == 0)? 0: ((volume == 3)? 255: 127);
+                    memset(audio_buffer->data + i, sim->minx->sound_pulse * multiplier, num_skipped);
+                }
+
+                Checks::skip_cycles(sim, num_skipped);
+                i += num_skipped - 1;
+                continue;
+            }
+        }
+
+        sim_clock_osc3_edge(sim, 1);
+        sim_clock_osc3_edge(sim, 0);
+
+        if(sim->minx->address_out == 0xAB)
+            sim_load_eeprom(sim, "eeprom000.bin");
+
+        // The byte is in the eeprom once the write pulse is over.
+        if(sim->eeprom_file)
+        {
+            bool eeprom_we = sim->minx->eeprom_internal_we;
+            if(sim->eeprom_we_old && !eeprom_we)
+                eeprom_file_update(sim->eeprom_file, sim->minx->rootp->minx__DOT__eeprom__DOT__rom.m_storage);
+            sim->eeprom_we_old = eeprom_we;
+        }
+
+        if(audio_buffer)
+        {
+            uint8_t volume = sim->minx->sound_volume;
+            uint8_t sound_pulse = sim->minx->sound_pulse;
+            uint8_t multiplier = (volume == 0)? 0: ((volume == 3)? 255: 127);
+            //audio_buffer->data[i] = (2 * sound_pulse - 1) * multiplier;
+            audio_buffer->data[i] = sound_pulse * multiplier;
+            //if(audio_buffer->data[i] < 0) --audio_buffer->data[i];
+        }
+
+        if(sim->minx->frame_complete && !frame_complete_latch)
+        {
+            if(sim->minx->rootp->minx__DOT__lcd__DOT__display_enabled)
+            {
+                for (int yC=0; yC<8; yC++)
+                {
+                    for (int xC=0; xC<96; xC++)
+                    {
+                        uint8_t data = sim->minx->rootp->minx__DOT__lcd__DOT__all_pixels_on_enabled ?
+                            0xFF:
+                            sim->minx->rootp->minx__DOT__lcd__DOT__invert_pixels_enabled?
+                                sim->minx->rootp->minx__DOT__lcd__DOT__lcd_data[yC * 132 + xC] ^ 0xFF:
+                                sim->minx->rootp->minx__DOT__lcd__DOT__lcd_data[yC * 132 + xC];
+                        sim->framebuffers[768 * sim->fb_write_index + yC * 96 + xC] = data;
+                    }
+                }
+            }
+            else memset(sim->framebuffers + 768 * sim->fb_write_index, 0, 96*8);
+            if(sim->frame_log)
+                frame_log_append(sim->frame_log, sim->timestamp / 2, sim->frame_count + 1, sim->framebuffers + 768 * sim->fb_write_index);
+            sim->fb_write_index = (sim->fb_write_index + 1) % 8;
+            ++sim->frame_count;
+
+            if(sim->eeprom_file && sim->frame_count % SIM_EEPROM_FLUSH_FRAMES == 0)
+            {
+                eeprom_file_update(sim->eeprom_file, sim->minx->rootp->minx__DOT__eeprom__DOT__rom.m_storage);
+                eeprom_file_flush(sim->eeprom_file);
+            }
+        }
+        frame_complete_latch = sim->minx->frame_complete;
+
+        // At rising edge of clock
+        sim->data_sent = false;
+
+        if(!Checks::check_cycle(sim))
+            break;
+
+        //static bool once = false;
+        //if(sim->minx->rootp->minx__DOT__cpu__DOT__extended_opcode == 0x1AE)
+        //{
+        //    if(!once) printf("timestamp: %llu\n", sim->timestamp);
+        //    once = true;
+        //}
+
+        //if(sim->minx->rootp->minx__DOT__sound__DOT__reg_sound_volume == 3)
+        //    printf("%llu\n", sim->timestamp);
+
+        //if(
+        //    sim->minx->rootp->minx__DOT__cpu__DOT__postpone_exception == 1 &&
+        //    sim->minx->rootp->iack == 1 &&
+        //    sim->minx->rootp->minx__DOT__cpu__DOT__NB > 0
+        //){
+        //    if(!sim->tfp)
+        //        sim_dump_start(sim, "temp.vcd");
+        //}
+
+        if(sim->minx->reset == 1 && sim->reset_counter < 8)
+            ++sim->reset_counter;
+        else if(sim->reset_counter >= 8)
+        {
+            sim->minx->reset = 0;
+            sim->reset_counter = 0;
+        }
+
+        if(sim->minx->bus_status == BUS_MEM_READ && sim->minx->pl == 0) // Check if PL=0 just to reduce spam.
+        {
+            // memory read
+            uint32_t address = sim->minx->address_out & 0xFFFFFF;
+            sim->minx->data_in = sim->pages[address >> SIM_PAGE_SHIFT].read[address & 0xFF];
+            if(sim->on_read) sim->on_read(sim, address);
+            if(sim->bus_log) sim_log_bus(sim, address, sim->minx->data_in, 0);
+
+            sim->data_sent = true;
+        }
+        else if(sim->minx->bus_status == BUS_MEM_WRITE && sim->minx->write)
+        {
+            // memory write, writes to bios, registers and cartridge are
+            // dropped.
+            uint32_t address = sim->minx->address_out & 0xFFFFFF;
+            sim->pages[address >> SIM_PAGE_SHIFT].write[address & 0xFF] = sim->minx->data_out;
+            if(sim->bus_log) sim_log_bus(sim, address, sim->minx->data_out, BUS_LOG_WRITE);
+
+            sim->data_sent = true;
+        }
+
+        if(sim->trace_window)
+            sim_trace_window_step(sim);
+    }
+}
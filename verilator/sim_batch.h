@@ -0,0 +1,145 @@
+// Runs a batch of independent simulation jobs on a pool of worker threads.
+//
+// Each job is advanced one quantum of emulated cycles at a time. Every worker
+// owns a queue of jobs: it takes the most recent job from the back of its
+// own queue, runs one quantum and puts the job back unless it finished. A
+// worker whose queue is empty steals the oldest job from the front of
+// another worker's queue. A single machine still runs serially, but short
+// jobs no longer leave cores idle while a long one finishes, and a worker
+// stuck behind a long job hands its other jobs to idle workers. A worker
+// that finds no job at all sleeps until a job is put back in a queue or
+// the batch is over, rather than spinning on the queues of the busy ones.
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct SimBatchJob
+{
+    // Advances the job by num_cycles OSC3 cycles (or up to its end) and
+    // returns true once the job is finished.
+    bool (*run)(SimBatchJob* job, uint32_t num_cycles);
+    void* user;
+};
+
+struct SimBatchQueue
+{
+    std::mutex mutex;
+    std::deque<SimBatchJob*> jobs;
+};
+
+struct SimBatchStats
+{
+    uint64_t quanta;
+    uint64_t steals;
+};
+
+static SimBatchJob* sim_batch_pop(SimBatchQueue* queue)
+{
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    if(queue->jobs.empty()) return nullptr;
+    SimBatchJob* job = queue->jobs.back();
+    queue->jobs.pop_back();
+    return job;
+}
+
+static SimBatchJob* sim_batch_steal(SimBatchQueue* queue)
+{
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    if(queue->jobs.empty()) return nullptr;
+    SimBatchJob* job = queue->jobs.front();
+    queue->jobs.pop_front();
+    return job;
+}
+
+static void sim_batch_push(SimBatchQueue* queue, SimBatchJob* job)
+{
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    queue->jobs.push_back(job);
+}
+
+// Runs all jobs to completion on num_threads workers, quantum_cycles at a
+// time. Returns once every job has finished.
+SimBatchStats sim_batch_run(SimBatchJob* const* jobs, size_t num_jobs, int num_threads, uint32_t quantum_cycles)
+{
+    if(num_threads < 1) num_threads = 1;
+
+    std::vector<SimBatchQueue> queues(num_threads);
+    for(size_t i = 0; i < num_jobs; ++i)
+        queues[i % num_threads].jobs.push_back(jobs[i]);
+
+    std::atomic<size_t>   num_unfinished(num_jobs);
+    std::atomic<uint64_t> num_quanta(0);
+    std::atomic<uint64_t> num_steals(0);
+
+    // Idle workers wait on idle_cv for num_pushes to change. A worker
+    // counts itself in num_idle before checking num_pushes, and one
+    // putting a job back bumps num_pushes before checking num_idle, so a
+    // wakeup can't fall between the two.
+    std::mutex idle_mutex;
+    std::condition_variable idle_cv;
+    std::atomic<uint64_t> num_pushes(0);
+    std::atomic<int> num_idle(0);
+    auto wake_idle = [&]()
+    {
+        if(num_idle > 0)
+        {
+            { std::lock_guard<std::mutex> lock(idle_mutex); }
+            idle_cv.notify_all();
+        }
+    };
+
+    auto worker = [&](int id)
+    {
+        while(num_unfinished > 0)
+        {
+            uint64_t pushes = num_pushes;
+            SimBatchJob* job = sim_batch_pop(&queues[id]);
+            for(int i = 1; !job && i < num_threads; ++i)
+            {
+                job = sim_batch_steal(&queues[(id + i) % num_threads]);
+                if(job) ++num_steals;
+            }
+
+            // Everything left is being run by other workers, wait for one
+            // of them to put a job back.
+            if(!job)
+            {
+                std::unique_lock<std::mutex> lock(idle_mutex);
+                ++num_idle;
+                idle_cv.wait(lock, [&]() { return num_pushes != pushes || num_unfinished == 0; });
+                --num_idle;
+                continue;
+            }
+
+            ++num_quanta;
+            if(job->run(job, quantum_cycles))
+            {
+                if(--num_unfinished == 0)
+                    wake_idle();
+            }
+            else
+            {
+                sim_batch_push(&queues[id], job);
+                ++num_pushes;
+                wake_idle();
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for(int i = 1; i < num_threads; ++i)
+        threads.emplace_back(worker, i);
+    worker(0);
+    for(auto& thread: threads)
+        thread.join();
+
+    SimBatchStats stats;
+    stats.quanta = num_quanta;
+    stats.steals = num_steals;
+    return stats;
+}
@@ -0,0 +1,289 @@
+#include "retire_log.h"
+#include "retire_print.h"
+#include "bus_log.h"
+#include "frame_log.h"
+
+// Finds the first point where two runs diverge, from the logs they wrote:
+// retire logs (retire_log.h) for the cpu state, bus logs (bus_log.h) for
+// the bus traffic and frame logs (frame_log.h) for the LCD. The kind of log
+// is read from the file header; both files must be of the same kind.
+//
+// Typical use when changing s1c88.sv or the microcode: run minx_bench with
+// -L/-B/-P on the old and the new model, then
+//
+//   sim_diff old_0.rlog new_0.rlog
+//
+// prints the last instructions both runs agree on, the first one they
+// don't and which fields differ.
+//
+// -t ignores timing (cycles and cycle counts), for changes that are meant
+// to alter timing but not behaviour. -c sets the number of matching
+// records printed before the divergence (8 by default).
+//
+// Usage: sim_diff [-t] [-c count] a.log b.log
+//
+// Returns 0 if the logs match, 1 if they diverge.
+
+struct DiffOptions
+{
+    bool ignore_timing;
+    int num_context;
+};
+
+static void diff_field(char* fields, size_t size, bool differs, const char* name)
+{
+    if(!differs) return;
+    size_t length = strlen(fields);
+    snprintf(fields + length, size - length, "%s%s", length? ", ": "", name);
+}
+
+int diff_retire_logs(const char* filepath_a, const char* filepath_b, const DiffOptions* options)
+{
+    RetireLogReader* a = retire_log_open_read(filepath_a);
+    RetireLogReader* b = retire_log_open_read(filepath_b);
+    if(!a || !b)
+        return -1;
+
+    // The last matching records, printed for context.
+    RetireRecord* context = (RetireRecord*) calloc(options->num_context + 1, sizeof(RetireRecord));
+    uint64_t index = 0;
+    int result = 0;
+    while(true)
+    {
+        RetireRecord record_a, record_b;
+        bool has_a = retire_log_read(a, &record_a);
+        bool has_b = retire_log_read(b, &record_b);
+        if(!has_a && !has_b)
+        {
+            printf("Retire logs match, %llu instructions.\n", (unsigned long long)index);
+            break;
+        }
+
+        char fields[256] = "";
+        if(has_a && has_b)
+        {
+            diff_field(fields, sizeof(fields), !options->ignore_timing && record_a.cycle != record_b.cycle, "cycle");
+            diff_field(fields, sizeof(fields), !options->ignore_timing && record_a.num_cycles != record_b.num_cycles, "cycles");
+            diff_field(fields, sizeof(fields), record_a.top_address != record_b.top_address, "address");
+            diff_field(fields, sizeof(fields), record_a.extended_opcode != record_b.extended_opcode, "opcode");
+            diff_field(fields, sizeof(fields), record_a.PC != record_b.PC, "PC");
+            diff_field(fields, sizeof(fields), record_a.SP != record_b.SP, "SP");
+            diff_field(fields, sizeof(fields), record_a.BA != record_b.BA, "BA");
+            diff_field(fields, sizeof(fields), record_a.HL != record_b.HL, "HL");
+            diff_field(fields, sizeof(fields), record_a.IX != record_b.IX, "IX");
+            diff_field(fields, sizeof(fields), record_a.IY != record_b.IY, "IY");
+            diff_field(fields, sizeof(fields), record_a.SC != record_b.SC, "SC");
+            diff_field(fields, sizeof(fields), record_a.CB != record_b.CB, "CB");
+            diff_field(fields, sizeof(fields), record_a.NB != record_b.NB, "NB");
+            diff_field(fields, sizeof(fields), record_a.EP != record_b.EP, "EP");
+            diff_field(fields, sizeof(fields), record_a.XP != record_b.XP, "XP");
+            diff_field(fields, sizeof(fields), record_a.YP != record_b.YP, "YP");
+            diff_field(fields, sizeof(fields), record_a.BR != record_b.BR, "BR");
+
+            if(fields[0] == 0)
+            {
+                if(options->num_context > 0)
+                    context[index % options->num_context] = record_a;
+                ++index;
+                continue;
+            }
+        }
+
+        printf("Retire logs diverge at instruction %llu:\n", (unsigned long long)index);
+        uint64_t first = (index > (uint64_t)options->num_context)? index - options->num_context: 0;
+        for(uint64_t i = first; i < index; ++i)
+        {
+            printf("     ");
+            retire_print_record(stdout, &context[i % options->num_context]);
+        }
+
+        printf("  a: ");
+        if(has_a) retire_print_record(stdout, &record_a);
+        else      printf("end of log\n");
+        printf("  b: ");
+        if(has_b) retire_print_record(stdout, &record_b);
+        else      printf("end of log\n");
+        if(fields[0])
+            printf("Differs in %s.\n", fields);
+
+        result = 1;
+        break;
+    }
+
+    free(context);
+    retire_log_close_read(a);
+    retire_log_close_read(b);
+    return result;
+}
+
+static void print_bus_record(const char* prefix, const BusRecord* record)
+{
+    printf("%s%12llu %-5s %06X %02X  %s at %04X\n", prefix,
+        (unsigned long long)record->cycle,
+        (record->flags & BUS_LOG_WRITE)? "write": "read",
+        record->address,
+        record->data,
+        (record->flags & BUS_LOG_PRC)? "prc": "cpu",
+        record->top_address);
+}
+
+int diff_bus_logs(FILE* a, FILE* b, const DiffOptions* options)
+{
+    BusRecord* context = (BusRecord*) calloc(options->num_context + 1, sizeof(BusRecord));
+    uint64_t index = 0;
+    int result = 0;
+    while(true)
+    {
+        BusRecord record_a, record_b;
+        bool has_a = fread(&record_a, sizeof(record_a), 1, a) == 1;
+        bool has_b = fread(&record_b, sizeof(record_b), 1, b) == 1;
+        if(!has_a && !has_b)
+        {
+            printf("Bus logs match, %llu transactions.\n", (unsigned long long)index);
+            break;
+        }
+
+        char fields[128] = "";
+        if(has_a && has_b)
+        {
+            diff_field(fields, sizeof(fields), !options->ignore_timing && record_a.cycle != record_b.cycle, "cycle");
+            diff_field(fields, sizeof(fields), record_a.address != record_b.address, "address");
+            diff_field(fields, sizeof(fields), record_a.data != record_b.data, "data");
+            diff_field(fields, sizeof(fields), record_a.flags != record_b.flags, "direction/initiator");
+            diff_field(fields, sizeof(fields), record_a.top_address != record_b.top_address && !(record_a.flags & BUS_LOG_PRC), "instruction");
+
+            if(fields[0] == 0)
+            {
+                if(options->num_context > 0)
+                    context[index % options->num_context] = record_a;
+                ++index;
+                continue;
+            }
+        }
+
+        printf("Bus logs diverge at transaction %llu:\n", (unsigned long long)index);
+        uint64_t first = (index > (uint64_t)options->num_context)? index - options->num_context: 0;
+        for(uint64_t i = first; i < index; ++i)
+            print_bus_record("     ", &context[i % options->num_context]);
+
+        if(has_a) print_bus_record("  a: ", &record_a);
+        else      printf("  a: end of log\n");
+        if(has_b) print_bus_record("  b: ", &record_b);
+        else      printf("  b: end of log\n");
+        if(fields[0])
+            printf("Differs in %s.\n", fields);
+
+        result = 1;
+        break;
+    }
+
+    free(context);
+    return result;
+}
+
+int diff_frame_logs(FILE* a, FILE* b, const DiffOptions* options)
+{
+    FrameRecord record_a, record_b;
+    uint64_t num_frames = 0;
+    while(true)
+    {
+        bool has_a = fread(&record_a, sizeof(record_a), 1, a) == 1;
+        bool has_b = fread(&record_b, sizeof(record_b), 1, b) == 1;
+        if(!has_a && !has_b)
+        {
+            printf("Frame logs match, %llu frames.\n", (unsigned long long)num_frames);
+            return 0;
+        }
+        if(!has_a || !has_b)
+        {
+            printf("Frame logs diverge after frame %llu: %s ends first.\n", (unsigned long long)num_frames, has_a? "b": "a");
+            return 1;
+        }
+
+        bool timing = !options->ignore_timing && record_a.cycle != record_b.cycle;
+        int num_bytes = 0;
+        int first_byte = -1;
+        for(int i = 0; i < 768; ++i)
+        {
+            if(record_a.data[i] == record_b.data[i]) continue;
+            if(first_byte < 0) first_byte = i;
+            ++num_bytes;
+        }
+
+        if(timing || num_bytes > 0)
+        {
+            printf("Frame logs diverge at frame %u (cycle %llu in a, %llu in b).\n",
+                record_a.frame, (unsigned long long)record_a.cycle, (unsigned long long)record_b.cycle);
+            if(num_bytes > 0)
+                printf("%d of 768 bytes differ, the first at column %d of page %d.\n", num_bytes, first_byte % 96, first_byte / 96);
+            return 1;
+        }
+        ++num_frames;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    DiffOptions options;
+    options.ignore_timing = false;
+    options.num_context = 8;
+
+    int arg = 1;
+    for(; arg < argc && argv[arg][0] == '-'; ++arg)
+    {
+        if(strcmp(argv[arg], "-t") == 0)
+            options.ignore_timing = true;
+        else if(strcmp(argv[arg], "-c") == 0 && arg + 1 < argc)
+            options.num_context = atoi(argv[++arg]);
+        else
+        {
+            fprintf(stderr, "Unknown option %s.\n", argv[arg]);
+            return -1;
+        }
+    }
+    if(options.num_context < 0) options.num_context = 0;
+
+    if(arg + 2 != argc)
+    {
+        fprintf(stderr, "Usage: %s [-t] [-c count] a.log b.log\n", argv[0]);
+        return -1;
+    }
+    const char* filepath_a = argv[arg];
+    const char* filepath_b = argv[arg + 1];
+
+    // All logs start with a 24 byte header: magic, version, record size.
+    FILE* a = fopen(filepath_a, "rb");
+    FILE* b = fopen(filepath_b, "rb");
+    char magic_a[24], magic_b[24];
+    if(!a || !b || fread(magic_a, 24, 1, a) != 1 || fread(magic_b, 24, 1, b) != 1)
+    {
+        fprintf(stderr, "Error reading %s and %s.\n", filepath_a, filepath_b);
+        return -1;
+    }
+    if(memcmp(magic_a, magic_b, 16) != 0)
+    {
+        fprintf(stderr, "%s and %s are not the same kind or version of log.\n", filepath_a, filepath_b);
+        return -1;
+    }
+
+    int result;
+    if(memcmp(magic_a, "MINXRET", 8) == 0)
+    {
+        fclose(a);
+        fclose(b);
+        return diff_retire_logs(filepath_a, filepath_b, &options);
+    }
+    else if(memcmp(magic_a, "MINXBUS", 8) == 0)
+        result = diff_bus_logs(a, b, &options);
+    else if(memcmp(magic_a, "MINXFRM", 8) == 0)
+        result = diff_frame_logs(a, b, &options);
+    else
+    {
+        fprintf(stderr, "Unknown log format in %s.\n", filepath_a);
+        result = -1;
+    }
+
+    fclose(a);
+    fclose(b);
+    return result;
+}
@@ -0,0 +1,144 @@
+// Branching a simulation with fork(): the process is forked at the current
+// cycle and the child carries on from there as an independent machine, the
+// pages of the parent shared copy-on-write until either side writes to
+// them. Exploring many inputs from one deep state then costs one fork per
+// branch instead of a replay from reset or a save state, e.g.
+//
+//   uint64_t hash;
+//   SimBranch branch;
+//   int side = sim_fork(&sim, &branch);
+//   if(side == 0)
+//   {
+//       sim.minx->keys_active = 0x01;
+//       simulate_steps<ChecksNone>(&sim, 400000);
+//       hash = sim_hash_frame(sim_get_frame(&sim, sim.frame_count));
+//       sim_branch_exit(&branch, &hash, sizeof(hash));
+//   }
+//   else if(side > 0)
+//       sim_branch_join(&branch, &hash, sizeof(hash));
+//
+// The child returns its result to the parent through a pipe. It doesn't
+// write to the logs or the dump the parent has open: those are dropped in
+// the child, the eeprom isn't saved, and a flight recorder writes to its
+// own files. Verilator's worker threads don't survive fork(), so the model
+// must be single threaded.
+#pragma once
+
+#include "sim.h"
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+struct SimBranch
+{
+    pid_t pid;
+    // Read end in the parent, write end in the child.
+    int fd;
+};
+
+// Returns 0 in the child, 1 in the parent, -1 if the process couldn't be
+// forked.
+int sim_fork(SimData* sim, SimBranch* branch)
+{
+    if(sim->context->threads() > 1)
+    {
+        PRINTE("Can't fork a model built with --threads.\n");
+        return -1;
+    }
+
+    int fds[2];
+    if(pipe(fds) != 0)
+    {
+        PRINTE("Error creating the pipe of a branch.\n");
+        return -1;
+    }
+
+    // Anything still buffered would be printed by both processes.
+    fflush(stdout);
+    fflush(stderr);
+
+    pid_t pid = fork();
+    if(pid < 0)
+    {
+        PRINTE("Error forking the simulation.\n");
+        close(fds[0]);
+        close(fds[1]);
+        return -1;
+    }
+
+    if(pid == 0)
+    {
+        close(fds[0]);
+        branch->pid = getpid();
+        branch->fd  = fds[1];
+
+        // The files are shared with the parent and the trace writers'
+        // threads are gone, so these are abandoned rather than closed.
+#if VM_TRACE_VCD
+        sim->tfp = nullptr;
+#if SIM_ASYNC_TRACE
+        sim->tfp_writer = nullptr;
+#endif
+#endif
+#if VM_TRACE_FST
+        sim->fst = nullptr;
+#endif
+        sim->trace_window = nullptr;
+        sim->retire_log   = nullptr;
+        sim->bus_log      = nullptr;
+        sim->frame_log    = nullptr;
+        // Nor does it save to the eeprom file of the parent.
+        sim->eeprom_file  = nullptr;
+        if(sim->recorder)
+        {
+            char filepath[256];
+            snprintf(filepath, sizeof(filepath), "%s_%d", sim->recorder->filepath, (int)branch->pid);
+            snprintf(sim->recorder->filepath, sizeof(sim->recorder->filepath), "%s", filepath);
+        }
+        return 0;
+    }
+
+    close(fds[1]);
+    branch->pid = pid;
+    branch->fd  = fds[0];
+    return 1;
+}
+
+// Ends the child, sending the result to the parent. Nothing of the parent's
+// state is torn down, the process just exits.
+void sim_branch_exit(SimBranch* branch, const void* result, size_t size)
+{
+    const uint8_t* p = (const uint8_t*) result;
+    while(size > 0)
+    {
+        ssize_t num_written = write(branch->fd, p, size);
+        if(num_written <= 0) break;
+        p    += num_written;
+        size -= num_written;
+    }
+    close(branch->fd);
+
+    fflush(stdout);
+    fflush(stderr);
+    _exit(0);
+}
+
+// Waits for the child and reads its result. Returns false if the child
+// ended without sending a whole one.
+bool sim_branch_join(SimBranch* branch, void* result, size_t size)
+{
+    uint8_t* p = (uint8_t*) result;
+    while(size > 0)
+    {
+        ssize_t num_read = read(branch->fd, p, size);
+        if(num_read <= 0) break;
+        p    += num_read;
+        size -= num_read;
+    }
+    close(branch->fd);
+
+    int status;
+    waitpid(branch->pid, &status, 0);
+    return size == 0 && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
@@ -0,0 +1,252 @@
+// Rewind buffer: a ring of in-memory save states (see sim_state.h) taken
+// every few frames, for stepping back in time while debugging.
+//
+// Only the newest state is kept whole. Every older one is kept as the
+// difference to the state after it: the two are xored, which leaves mostly
+// zeros since little of the ram, eeprom and model changes in a few frames,
+// and the result is run length encoded as
+//
+//   [zero run][literal run][literal bytes] ...
+//
+// with both runs as LEB128 varints. Going back one state decodes one
+// delta onto the newest state, so rewinding is cheap however long the
+// history; the oldest states are dropped once the deltas exceed the memory
+// budget. A frame between two states is reached by restoring the state
+// before it and simulating the remaining frames, never more than the
+// interval.
+//
+// Rewinding discards the states after the point rewound to, the run
+// continues from there as a new timeline.
+#pragma once
+
+#include "sim_state.h"
+
+struct SimRewindDelta
+{
+    uint8_t* data;
+    size_t size;
+    uint32_t frame;
+};
+
+struct SimRewind
+{
+    // Frames between states.
+    uint32_t interval;
+
+    // The newest state, whole, and the frame it was taken at.
+    uint8_t* latest;
+    size_t latest_size;
+    uint32_t latest_frame;
+    bool has_latest;
+
+    // Deltas of the older states, a ring from the oldest (first) to the
+    // newest.
+    SimRewindDelta* deltas;
+    uint32_t max_deltas;
+    uint32_t first;
+    uint32_t num_deltas;
+    size_t deltas_size;
+    size_t max_size;
+
+    // Scratch buffer, as large as the largest encoded delta can be.
+    uint8_t* scratch;
+    size_t scratch_size;
+
+    SimStateHeader header;
+};
+
+SimRewind* sim_rewind_create(const SimData* sim, uint32_t interval, size_t max_size)
+{
+    SimRewind* rewind = (SimRewind*) calloc(1, sizeof(SimRewind));
+    rewind->interval   = (interval > 0)? interval: 1;
+    rewind->max_deltas = 65536;
+    rewind->deltas     = (SimRewindDelta*) calloc(rewind->max_deltas, sizeof(SimRewindDelta));
+    rewind->max_size   = max_size;
+    sim_state_header(sim, &rewind->header);
+    return rewind;
+}
+
+void sim_rewind_drop_oldest(SimRewind* rewind)
+{
+    SimRewindDelta* delta = &rewind->deltas[rewind->first];
+    rewind->deltas_size -= delta->size;
+    free(delta->data);
+    delta->data = nullptr;
+    rewind->first = (rewind->first + 1) % rewind->max_deltas;
+    --rewind->num_deltas;
+}
+
+void sim_rewind_destroy(SimRewind* rewind)
+{
+    while(rewind->num_deltas > 0)
+        sim_rewind_drop_oldest(rewind);
+    free(rewind->deltas);
+    free(rewind->latest);
+    free(rewind->scratch);
+    free(rewind);
+}
+
+static void rewind_put_varint(uint8_t** p, size_t value)
+{
+    while(value >= 0x80)
+    {
+        *(*p)++ = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    *(*p)++ = (uint8_t)value;
+}
+
+static size_t rewind_get_varint(const uint8_t** p)
+{
+    size_t value = 0;
+    for(int shift = 0;; shift += 7)
+    {
+        uint8_t byte = *(*p)++;
+        value |= (size_t)(byte & 0x7F) << shift;
+        if(!(byte & 0x80)) return value;
+    }
+}
+
+// Encodes a xor b into out, which must hold size + size / 2 + 16 bytes.
+// A literal run ends at the first two zero bytes, shorter gaps are cheaper
+// to keep in the literal.
+size_t sim_rewind_encode(const uint8_t* a, const uint8_t* b, size_t size, uint8_t* out)
+{
+    uint8_t* p = out;
+    size_t i = 0;
+    while(i < size)
+    {
+        size_t zeros_start = i;
+        while(i < size && a[i] == b[i]) ++i;
+        size_t literal_start = i;
+        while(i < size && (a[i] != b[i] || (i + 1 < size && a[i + 1] != b[i + 1]))) ++i;
+
+        rewind_put_varint(&p, literal_start - zeros_start);
+        rewind_put_varint(&p, i - literal_start);
+        for(size_t j = literal_start; j < i; ++j)
+            *p++ = a[j] ^ b[j];
+    }
+    return p - out;
+}
+
+// Xors an encoded delta onto state.
+void sim_rewind_apply(uint8_t* state, const uint8_t* delta, size_t delta_size)
+{
+    const uint8_t* p = delta;
+    const uint8_t* end = delta + delta_size;
+    size_t position = 0;
+    while(p < end)
+    {
+        position += rewind_get_varint(&p);
+        size_t num_literals = rewind_get_varint(&p);
+        for(size_t i = 0; i < num_literals; ++i)
+            state[position++] ^= *p++;
+    }
+}
+
+#if SIM_SAVESTATE
+// Takes a state if the interval has passed since the last one. Call after
+// every batch of simulated steps.
+void sim_rewind_step(SimRewind* rewind, SimData* sim)
+{
+    if(rewind->has_latest && sim->frame_count < rewind->latest_frame + rewind->interval)
+        return;
+
+    SimMemorySave os;
+    sim_state_write(sim, os, &rewind->header);
+    os.close();
+
+    if(rewind->has_latest && os.size == rewind->latest_size)
+    {
+        if(rewind->scratch_size < os.size + os.size / 2 + 16)
+        {
+            rewind->scratch_size = os.size + os.size / 2 + 16;
+            rewind->scratch = (uint8_t*) realloc(rewind->scratch, rewind->scratch_size);
+        }
+
+        if(rewind->num_deltas == rewind->max_deltas)
+            sim_rewind_drop_oldest(rewind);
+
+        SimRewindDelta* delta = &rewind->deltas[(rewind->first + rewind->num_deltas) % rewind->max_deltas];
+        delta->size  = sim_rewind_encode(rewind->latest, os.data, os.size, rewind->scratch);
+        delta->data  = (uint8_t*) malloc(delta->size);
+        delta->frame = rewind->latest_frame;
+        memcpy(delta->data, rewind->scratch, delta->size);
+        ++rewind->num_deltas;
+        rewind->deltas_size += delta->size;
+
+        while(rewind->deltas_size + rewind->latest_size > rewind->max_size && rewind->num_deltas > 0)
+            sim_rewind_drop_oldest(rewind);
+    }
+    else
+    {
+        // The first state, or the model changed size; older states can't
+        // be reached from this one.
+        while(rewind->num_deltas > 0)
+            sim_rewind_drop_oldest(rewind);
+    }
+
+    // Keep the buffer of the save stream as the new latest state.
+    free(rewind->latest);
+    rewind->latest       = os.data;
+    rewind->latest_size  = os.size;
+    rewind->latest_frame = sim->frame_count;
+    rewind->has_latest   = true;
+    os.data     = nullptr;
+    os.size     = 0;
+    os.capacity = 0;
+}
+
+// Moves the machine back to the given frame, or as far back as the buffer
+// goes. Returns the frame it got to.
+uint32_t sim_rewind_to_frame(SimRewind* rewind, SimData* sim, uint32_t frame)
+{
+    if(!rewind->has_latest)
+        return sim->frame_count;
+
+    // Back to the newest state at or before the frame.
+    while(rewind->latest_frame > frame && rewind->num_deltas > 0)
+    {
+        uint32_t last = (rewind->first + rewind->num_deltas - 1) % rewind->max_deltas;
+        SimRewindDelta* delta = &rewind->deltas[last];
+        sim_rewind_apply(rewind->latest, delta->data, delta->size);
+        rewind->latest_frame = delta->frame;
+        rewind->deltas_size -= delta->size;
+        free(delta->data);
+        delta->data = nullptr;
+        --rewind->num_deltas;
+    }
+
+    SimMemoryRestore os(rewind->latest, rewind->latest_size);
+    sim_state_read(sim, os, &rewind->header, "Rewind state");
+    os.close();
+
+    // Then forward to the frame itself.
+    while(sim->frame_count < frame && !sim->context->gotFinish())
+        simulate_steps(sim, 1000);
+
+    return sim->frame_count;
+}
+#else
+void sim_rewind_step(SimRewind* rewind, SimData* sim) {}
+
+uint32_t sim_rewind_to_frame(SimRewind* rewind, SimData* sim, uint32_t frame)
+{
+    PRINTE("Rewinding needs a model built with --savable.\n");
+    return sim->frame_count;
+}
+#endif
+
+// Bytes of state held, for reporting.
+size_t sim_rewind_size(const SimRewind* rewind)
+{
+    return rewind->latest_size + rewind->deltas_size;
+}
+
+// Frame of the oldest state held.
+uint32_t sim_rewind_oldest_frame(const SimRewind* rewind)
+{
+    if(rewind->num_deltas > 0)
+        return rewind->deltas[rewind->first].frame;
+    return rewind->latest_frame;
+}
@@ -0,0 +1,361 @@
+// Save states: the complete state of a machine, i.e. the model (registers
+// and memories, eeprom included), the ram and framebuffers served by the
+// harness, the oscillator phases and the harness state kept in SimData.
+// Restoring one resumes the simulation cycle exactly where it was saved,
+// so long boots and intros only have to be simulated once.
+//
+// The model is serialized by verilator, which requires building it with
+// --savable; the build scripts do so and define SIM_SAVESTATE. A state
+// file is the verilator save stream holding, in order, a SimStateHeader,
+// a SimStateHarness, the 4KB ram, the framebuffers and the model.
+//
+// States are only valid for the model, bios and cartridge they were saved
+// with. The header records hashes of the images and verilator checks the
+// model itself, refusing states of a different design.
+//
+// The trace window, logs, flight recorder and coverage are not part of the
+// state; they keep running across a restore.
+#pragma once
+
+#include "sim.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifndef SIM_SAVESTATE
+#define SIM_SAVESTATE 0
+#endif
+#if SIM_SAVESTATE
+#include "verilated_save.h"
+#endif
+
+#define SIM_STATE_VERSION 1
+
+// What VerilatedSave writes at the start of every file.
+#define SIM_STATE_VERILATOR_MAGIC "verilatorsave01"
+
+struct SimStateHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t harness_size;
+    uint64_t bios_hash;
+    uint64_t cartridge_hash;
+};
+
+// The SimData fields that are part of the machine state.
+struct SimStateHarness
+{
+    uint64_t timestamp;
+    uint64_t time;
+    uint64_t osc1_next_edge;
+    uint64_t osc3_next_edge;
+    uint32_t frame_count;
+    int32_t irq_copy_complete_old;
+    int32_t num_cycles_since_sync;
+    int32_t reset_counter;
+    uint8_t fb_write_index;
+    uint8_t data_sent;
+    uint8_t irq_processing;
+    uint8_t reserved[5];
+};
+
+static_assert(sizeof(SimStateHeader) == 32, "SimStateHeader must be packed");
+static_assert(sizeof(SimStateHarness) == 56, "SimStateHarness must be packed");
+
+void sim_state_header(const SimData* sim, SimStateHeader* header)
+{
+    memset(header, 0, sizeof(*header));
+    memcpy(header->magic, "MINXSAV", 8);
+    header->version        = SIM_STATE_VERSION;
+    header->harness_size   = sizeof(SimStateHarness);
+    header->bios_hash      = sim_hash_image(sim->bios, sim->bios_file_size);
+    header->cartridge_hash = sim_hash_image(sim->cartridge, sim->cartridge_file_size);
+}
+
+void sim_state_get_harness(const SimData* sim, SimStateHarness* harness)
+{
+    memset(harness, 0, sizeof(*harness));
+    harness->timestamp             = sim->timestamp;
+    harness->time                  = sim->time;
+    harness->osc1_next_edge        = sim->osc1_next_edge;
+    harness->osc3_next_edge        = sim->osc3_next_edge;
+    harness->frame_count           = sim->frame_count;
+    harness->irq_copy_complete_old = sim->irq_copy_complete_old;
+    harness->num_cycles_since_sync = sim->num_cycles_since_sync;
+    harness->reset_counter         = sim->reset_counter;
+    harness->fb_write_index        = sim->fb_write_index;
+    harness->data_sent             = sim->data_sent;
+    harness->irq_processing        = sim->irq_processing;
+}
+
+void sim_state_set_harness(SimData* sim, const SimStateHarness* harness)
+{
+    sim->timestamp             = harness->timestamp;
+    sim->time                  = harness->time;
+    sim->osc1_next_edge        = harness->osc1_next_edge;
+    sim->osc3_next_edge        = harness->osc3_next_edge;
+    sim->frame_count           = harness->frame_count;
+    sim->irq_copy_complete_old = harness->irq_copy_complete_old;
+    sim->num_cycles_since_sync = harness->num_cycles_since_sync;
+    sim->reset_counter         = harness->reset_counter;
+    sim->fb_write_index        = harness->fb_write_index % 8;
+    sim->data_sent             = harness->data_sent;
+    sim->irq_processing        = harness->irq_processing;
+}
+
+#if SIM_SAVESTATE
+// Writes the state to a verilator save stream. The header is passed in so
+// callers taking many states don't hash the images every time.
+void sim_state_write(SimData* sim, VerilatedSerialize& os, const SimStateHeader* header)
+{
+    SimStateHarness harness;
+    sim_state_get_harness(sim, &harness);
+    os.write(header, sizeof(*header));
+    os.write(&harness, sizeof(harness));
+    os.write(sim->memory, 4*1024);
+    os.write(sim->framebuffers, sizeof(sim->framebuffers));
+    os << *sim->minx;
+}
+
+// Reads a state written by sim_state_write(), leaving the machine alone if
+// its header doesn't match the expected one.
+bool sim_state_read(SimData* sim, VerilatedDeserialize& os, const SimStateHeader* expected, const char* name)
+{
+    SimStateHeader header;
+    os.read(&header, sizeof(header));
+    if(memcmp(header.magic, expected->magic, 8) != 0 || header.version != SIM_STATE_VERSION || header.harness_size != sizeof(SimStateHarness))
+    {
+        PRINTE("%s is not a version %u save state.\n", name, SIM_STATE_VERSION);
+        return false;
+    }
+    if(header.bios_hash != expected->bios_hash || header.cartridge_hash != expected->cartridge_hash)
+    {
+        PRINTE("%s was saved with a different bios or cartridge.\n", name);
+        return false;
+    }
+
+    SimStateHarness harness;
+    os.read(&harness, sizeof(harness));
+    os.read(sim->memory, 4*1024);
+    os.read(sim->framebuffers, sizeof(sim->framebuffers));
+    os >> *sim->minx;
+    sim_state_set_harness(sim, &harness);
+    return true;
+}
+
+bool sim_save_state(SimData* sim, const char* filepath)
+{
+    VerilatedSave os;
+    os.open(filepath);
+    if(!os.isOpen())
+    {
+        PRINTE("Error opening save state %s.\n", filepath);
+        return false;
+    }
+
+    SimStateHeader header;
+    sim_state_header(sim, &header);
+    sim_state_write(sim, os, &header);
+    os.close();
+
+    PRINTE("Saved state at cycle %llu to %s.\n", (unsigned long long)(sim->timestamp / 2), filepath);
+    return true;
+}
+
+bool sim_load_state(SimData* sim, const char* filepath)
+{
+    // VerilatedRestore aborts on anything that isn't one of its files, so
+    // check the magic before handing the file over.
+    {
+        char magic[sizeof(SIM_STATE_VERILATOR_MAGIC) - 1];
+        FILE* fp = fopen(filepath, "rb");
+        bool is_state = fp && fread(magic, sizeof(magic), 1, fp) == 1 && memcmp(magic, SIM_STATE_VERILATOR_MAGIC, sizeof(magic)) == 0;
+        if(fp) fclose(fp);
+        if(!is_state)
+        {
+            PRINTE("%s is not a save state.\n", filepath);
+            return false;
+        }
+    }
+
+    VerilatedRestore os;
+    os.open(filepath);
+    if(!os.isOpen())
+    {
+        PRINTE("Error opening save state %s.\n", filepath);
+        return false;
+    }
+
+    SimStateHeader expected;
+    sim_state_header(sim, &expected);
+    bool loaded = sim_state_read(sim, os, &expected, filepath);
+    os.close();
+    if(!loaded)
+        return false;
+
+    PRINTE("Loaded state at cycle %llu from %s.\n", (unsigned long long)(sim->timestamp / 2), filepath);
+    return true;
+}
+
+// Verilator save streams kept in memory instead of a file, for states that
+// are taken often, see sim_rewind.h.
+class SimMemorySave : public VerilatedSerialize
+{
+public:
+    uint8_t* data;
+    size_t size;
+    size_t capacity;
+
+    SimMemorySave(): data(nullptr), size(0), capacity(0) { m_isOpen = true; }
+    ~SimMemorySave() override { close(); free(data); }
+
+    void flush() override
+    {
+        size_t num_bytes = m_cp - m_bufp;
+        if(size + num_bytes > capacity)
+        {
+            capacity = 2 * (size + num_bytes);
+            data = (uint8_t*) realloc(data, capacity);
+        }
+        memcpy(data + size, m_bufp, num_bytes);
+        size += num_bytes;
+        m_cp = m_bufp;
+    }
+};
+
+class SimMemoryRestore : public VerilatedDeserialize
+{
+public:
+    const uint8_t* data;
+    size_t size;
+    size_t position;
+
+    SimMemoryRestore(const uint8_t* data, size_t size): data(data), size(size), position(0)
+    {
+        m_isOpen = true;
+        m_cp     = m_bufp;
+        m_endp   = m_bufp;
+    }
+
+    void fill() override
+    {
+        // Keep what hasn't been read yet and top the buffer up.
+        size_t num_left = m_endp - m_cp;
+        memmove(m_bufp, m_cp, num_left);
+        m_cp   = m_bufp;
+        m_endp = m_bufp + num_left;
+
+        size_t num_bytes = bufferSize() - num_left;
+        if(num_bytes > size - position) num_bytes = size - position;
+        memcpy(m_endp, data + position, num_bytes);
+        m_endp   += num_bytes;
+        position += num_bytes;
+    }
+};
+#else
+bool sim_save_state(SimData* sim, const char* filepath)
+{
+    PRINTE("Save states need a model built with --savable.\n");
+    return false;
+}
+
+bool sim_load_state(SimData* sim, const char* filepath)
+{
+    PRINTE("Save states need a model built with --savable.\n");
+    return false;
+}
+#endif
+
+// Boot cache: a directory of save states taken when the bios hands over to
+// the cartridge, keyed by the hashes of the bios, the cartridge, the
+// eeprom it starts from (see sim_open_eeprom()) and the model. Starting
+// from one skips the bios boot entirely; the cached state is what the run
+// would have reached anyway, so runs behave the same with a cold or a warm
+// cache. The clock the bios sets from the eeprom is the one of the run
+// that filled the cache.
+//
+// The clock at the end of the eeprom (SIM_EEPROM_CLOCK_ADDRESS onwards) is
+// rewritten at every boot by sim_load_eeprom() and saved to the eeprom
+// file, so it is left out of the key; otherwise every run with a file
+// backed eeprom would miss the cache and add another state to it.
+//
+// The clock is the one of the run that filled the cache, unless the start
+// time is fixed (sim_set_start_time()), then it is part of the key.
+//
+// The build scripts define SIM_BUILD_ID as a hash of the rtl and the
+// verilator flags. Without it, the time the harness was compiled stands in
+// for it and the cache only lasts until the next build.
+#ifndef SIM_BUILD_ID
+#define SIM_BUILD_ID sim_hash_image((const uint8_t*)(__DATE__ " " __TIME__), sizeof(__DATE__ " " __TIME__) - 1)
+#endif
+
+// The bios is done once the cpu runs from the cartridge.
+#define SIM_BOOT_END_PC 0x2000
+#define SIM_BOOT_MAX_CYCLES 64000000
+#define SIM_EEPROM_CLOCK_ADDRESS 0x1FF6
+
+void sim_boot_cache_path(const SimData* sim, const char* cache_dir, char* filepath, size_t size)
+{
+    snprintf(filepath, size, "%s/%016llx_%016llx_%016llx_%016llx.sav", cache_dir,
+        (unsigned long long)sim_hash_image(sim->bios, sim->bios_file_size),
+        (unsigned long long)sim_hash_image(sim->cartridge, sim->cartridge_file_size),
+        (unsigned long long)sim_hash_image(sim->minx->rootp->minx__DOT__eeprom__DOT__rom.m_storage, SIM_EEPROM_CLOCK_ADDRESS),
+        (unsigned long long)(SIM_BUILD_ID));
+    if(sim->start_time_fixed)
+    {
+        size_t length = strlen(filepath);
+        snprintf(filepath + length - 4, size - (length - 4), "_t%lld.sav", (long long)sim->start_time);
+    }
+}
+
+// Brings a freshly initialized machine to the end of the boot, from the
+// cache if it has the state, otherwise by simulating it and adding the
+// state to the cache. Returns false if the machine was left at reset.
+template<typename Checks = ChecksValidate>
+bool sim_boot_cached(SimData* sim, const char* cache_dir)
+{
+#if SIM_SAVESTATE
+    char filepath[512];
+    sim_boot_cache_path(sim, cache_dir, filepath, sizeof(filepath));
+    FILE* fp = fopen(filepath, "rb");
+    if(fp)
+    {
+        fclose(fp);
+        if(sim_load_state(sim, filepath))
+            return true;
+    }
+
+    while(sim->minx->rootp->minx__DOT__cpu__DOT__PC < SIM_BOOT_END_PC)
+    {
+        if(sim->timestamp / 2 >= SIM_BOOT_MAX_CYCLES || sim->context->gotFinish())
+        {
+            PRINTE("The bios didn't start the cartridge within %u cycles, not caching the boot.\n", SIM_BOOT_MAX_CYCLES);
+            return true;
+        }
+        simulate_steps<Checks>(sim, 1);
+    }
+
+    // Several processes, or threads of one, may boot the same cartridge at
+    // once, so the state is written to a file of its own and renamed into
+    // place.
+    char temp_filepath[532];
+    snprintf(temp_filepath, sizeof(temp_filepath), "%s.XXXXXX", filepath);
+    mkdir(cache_dir, 0777);
+    int fd = mkstemp(temp_filepath);
+    if(fd < 0)
+    {
+        PRINTE("Error creating a temporary file in %s, not caching the boot.\n", cache_dir);
+        return true;
+    }
+    close(fd);
+    if(sim_save_state(sim, temp_filepath))
+        rename(temp_filepath, filepath);
+    else
+        unlink(temp_filepath);
+    return true;
+#else
+    PRINTE("The boot cache needs a model built with --savable.\n");
+    return false;
+#endif
+}
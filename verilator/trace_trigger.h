@@ -0,0 +1,238 @@
+// Trigger expressions for starting and stopping traces on events instead
+// of raw timestamps.
+//
+// An expression is one or more conditions joined by && (or "and") and ||
+// (or "or"), && binding tighter. Conditions are:
+//
+//   frame N            frame N has been completed
+//   timestamp N        the timestamp has reached N
+//   cycle N            the timestamp has reached 2 * N
+//   pc == X            the cpu fetches an opcode from address X
+//   read X             the bus reads from address X ("read from X")
+//   write X            the bus writes to address X ("write to X")
+//   irq N              the cpu takes irq vector N
+//
+// Numbers are decimal or 0x prefixed hex. The trigger fires on the cycle
+// the expression becomes true, e.g. "frame 311 && pc == 0x4C5C" fires on
+// the first fetch from 0x4C5C after frame 311.
+//
+// The trigger knows nothing about the model; sim.h fills in a TriggerSample
+// every cycle, see sim_set_trace_window().
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <strings.h>
+
+enum TriggerKind
+{
+    TRIGGER_FRAME,
+    TRIGGER_TIMESTAMP,
+    TRIGGER_PC,
+    TRIGGER_READ,
+    TRIGGER_WRITE,
+    TRIGGER_IRQ
+};
+
+struct TriggerTerm
+{
+    TriggerKind kind;
+    uint64_t value;
+
+    // Set on the last term of a group of && terms, i.e. before a || or at
+    // the end of the expression.
+    bool ends_group;
+};
+
+#define TRIGGER_MAX_TERMS 16
+
+struct TraceTrigger
+{
+    TriggerTerm terms[TRIGGER_MAX_TERMS];
+    int num_terms;
+
+    // Value of the expression on the previous cycle, the trigger fires on
+    // its rising edge.
+    bool last;
+    char text[128];
+};
+
+// State of the machine in one cycle.
+struct TriggerSample
+{
+    uint32_t frame;
+    uint64_t timestamp;
+    uint32_t address;
+    bool fetch;
+    bool read;
+    bool write;
+
+    // Vector being taken, -1 if none.
+    int irq;
+};
+
+static bool trace_trigger_number(const char* token, uint64_t* value)
+{
+    char* end;
+    *value = strtoull(token, &end, 0);
+    return *token && *end == 0;
+}
+
+// Parses an expression, returns false and prints the reason if it is
+// invalid.
+bool trace_trigger_parse(TraceTrigger* trigger, const char* text)
+{
+    trigger->num_terms = 0;
+    trigger->last = false;
+    snprintf(trigger->text, sizeof(trigger->text), "%s", text);
+
+    // Split into tokens, "==" and the operators don't need spaces around
+    // them. Every write checks it leaves room for the final terminator.
+    char buffer[256];
+    const char* tokens[64];
+    int num_tokens = 0;
+    size_t length = 0;
+    for(const char* c = text; *c; ++c)
+    {
+        bool op = (c[0] == '=' && c[1] == '=') || (c[0] == '&' && c[1] == '&') || (c[0] == '|' && c[1] == '|');
+        bool starts_token = op || (*c != ' ' && *c != '\t' && (length == 0 || buffer[length - 1] == 0));
+        // An operator may end the previous token too.
+        size_t num_bytes = op? 4: 1;
+        if(length + num_bytes >= sizeof(buffer) || (starts_token && num_tokens == 64))
+        {
+            fprintf(stderr, "Trigger \"%s\" is too long.\n", text);
+            return false;
+        }
+
+        if(op || *c == ' ' || *c == '\t')
+        {
+            if(length > 0 && buffer[length - 1] != 0)
+                buffer[length++] = 0;
+            if(!op) continue;
+
+            tokens[num_tokens++] = buffer + length;
+            buffer[length++] = c[0];
+            buffer[length++] = c[1];
+            buffer[length++] = 0;
+            ++c;
+            continue;
+        }
+
+        if(starts_token)
+            tokens[num_tokens++] = buffer + length;
+        buffer[length++] = *c;
+    }
+    buffer[length] = 0;
+
+    int t = 0;
+    while(t < num_tokens)
+    {
+        if(trigger->num_terms == TRIGGER_MAX_TERMS)
+        {
+            fprintf(stderr, "Trigger \"%s\" has more than %d conditions.\n", text, TRIGGER_MAX_TERMS);
+            return false;
+        }
+
+        TriggerTerm* term = &trigger->terms[trigger->num_terms++];
+        const char* name = tokens[t++];
+        if(strcasecmp(name, "frame") == 0)
+            term->kind = TRIGGER_FRAME;
+        else if(strcasecmp(name, "timestamp") == 0 || strcasecmp(name, "cycle") == 0)
+            term->kind = TRIGGER_TIMESTAMP;
+        else if(strcasecmp(name, "pc") == 0)
+        {
+            term->kind = TRIGGER_PC;
+            if(t < num_tokens && strcmp(tokens[t], "==") == 0) ++t;
+        }
+        else if(strcasecmp(name, "read") == 0)
+        {
+            term->kind = TRIGGER_READ;
+            if(t < num_tokens && strcasecmp(tokens[t], "from") == 0) ++t;
+        }
+        else if(strcasecmp(name, "write") == 0)
+        {
+            term->kind = TRIGGER_WRITE;
+            if(t < num_tokens && strcasecmp(tokens[t], "to") == 0) ++t;
+        }
+        else if(strcasecmp(name, "irq") == 0)
+        {
+            term->kind = TRIGGER_IRQ;
+            if(t < num_tokens && strcasecmp(tokens[t], "vector") == 0) ++t;
+        }
+        else
+        {
+            fprintf(stderr, "Unknown trigger condition \"%s\" in \"%s\".\n", name, text);
+            return false;
+        }
+
+        if(t == num_tokens || !trace_trigger_number(tokens[t], &term->value))
+        {
+            fprintf(stderr, "Expected a number after \"%s\" in \"%s\".\n", name, text);
+            return false;
+        }
+        if(strcasecmp(name, "cycle") == 0)
+            term->value *= 2;
+        ++t;
+
+        term->ends_group = true;
+        if(t == num_tokens)
+            break;
+
+        if(strcmp(tokens[t], "&&") == 0 || strcasecmp(tokens[t], "and") == 0)
+            term->ends_group = false;
+        else if(strcmp(tokens[t], "||") != 0 && strcasecmp(tokens[t], "or") != 0)
+        {
+            fprintf(stderr, "Expected && or || instead of \"%s\" in \"%s\".\n", tokens[t], text);
+            return false;
+        }
+        if(++t == num_tokens)
+        {
+            fprintf(stderr, "Trigger \"%s\" ends with an operator.\n", text);
+            return false;
+        }
+    }
+
+    if(trigger->num_terms == 0)
+    {
+        fprintf(stderr, "Empty trigger.\n");
+        return false;
+    }
+    return true;
+}
+
+static inline bool trace_trigger_term(const TriggerTerm* term, const TriggerSample* sample)
+{
+    switch(term->kind)
+    {
+        case TRIGGER_FRAME:     return sample->frame >= term->value;
+        case TRIGGER_TIMESTAMP: return sample->timestamp >= term->value;
+        case TRIGGER_PC:        return sample->fetch && sample->address == term->value;
+        case TRIGGER_READ:      return sample->read && sample->address == term->value;
+        case TRIGGER_WRITE:     return sample->write && sample->address == term->value;
+        case TRIGGER_IRQ:       return sample->irq == (int)term->value;
+    }
+    return false;
+}
+
+// Returns true on the cycle the expression becomes true.
+static inline bool trace_trigger_update(TraceTrigger* trigger, const TriggerSample* sample)
+{
+    bool value = false;
+    bool group = true;
+    for(int i = 0; i < trigger->num_terms; ++i)
+    {
+        const TriggerTerm* term = &trigger->terms[i];
+        group = group && trace_trigger_term(term, sample);
+        if(term->ends_group)
+        {
+            value = value || group;
+            group = true;
+        }
+    }
+
+    bool fired = value && !trigger->last;
+    trigger->last = value;
+    return fired;
+}
@@ -0,0 +1,143 @@
+// Asynchronous file backend for VerilatedVcdC.
+//
+// Verilator formats the VCD text on the simulation thread and hands it to
+// a VerilatedVcdFile in small chunks. The default one calls write() on the
+// file descriptor for each of them, so the simulation stalls on disk I/O
+// every few cycles. SimTraceWriter copies the chunks into one of two large
+// blocks instead. When a block is full it is passed to a writer thread,
+// and the simulation carries on filling the other block. The simulation
+// thread only waits if the disk can't keep up with a whole block.
+//
+// FST dumps don't go through a VerilatedVcdFile. Build them with
+// TRACE_THREADS=2 (see build.sh) so Verilator encodes them on a thread of
+// its own.
+#pragma once
+
+#include "verilated_vcd_c.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <cstdio>
+#include <cstring>
+
+#define SIM_TRACE_BLOCK_SIZE (4 * 1024 * 1024)
+
+class SimTraceWriter : public VerilatedVcdFile
+{
+public:
+    SimTraceWriter()
+    {
+        fp = nullptr;
+        blocks[0] = (char*) malloc(SIM_TRACE_BLOCK_SIZE);
+        blocks[1] = (char*) malloc(SIM_TRACE_BLOCK_SIZE);
+    }
+
+    ~SimTraceWriter() override
+    {
+        close();
+        free(blocks[0]);
+        free(blocks[1]);
+    }
+
+    bool open(const std::string& name) override
+    {
+        fp = fopen(name.c_str(), "wb");
+        if(!fp) return false;
+
+        fill_block  = 0;
+        fill_size   = 0;
+        write_size  = 0;
+        write_block = -1;
+        stop = false;
+        writer = std::thread(&SimTraceWriter::run, this);
+        return true;
+    }
+
+    void close() override
+    {
+        if(!fp) return;
+
+        submit();
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            stop = true;
+        }
+        cv.notify_all();
+        writer.join();
+
+        fclose(fp);
+        fp = nullptr;
+    }
+
+    ssize_t write(const char* data, ssize_t length) override
+    {
+        ssize_t remaining = length;
+        while(remaining > 0)
+        {
+            size_t count = SIM_TRACE_BLOCK_SIZE - fill_size;
+            if(count > (size_t)remaining) count = remaining;
+
+            memcpy(blocks[fill_block] + fill_size, data, count);
+            fill_size += count;
+            data      += count;
+            remaining -= count;
+
+            if(fill_size == SIM_TRACE_BLOCK_SIZE)
+                submit();
+        }
+        return length;
+    }
+
+private:
+    // Hands the block being filled to the writer thread, once it is done
+    // with the previous one, and starts filling the other block.
+    void submit()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [this]{ return write_block < 0; });
+        if(fill_size == 0) return;
+
+        write_block = fill_block;
+        write_size  = fill_size;
+        fill_block  = 1 - fill_block;
+        fill_size   = 0;
+        cv.notify_all();
+    }
+
+    void run()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while(true)
+        {
+            cv.wait(lock, [this]{ return write_block >= 0 || stop; });
+            if(write_block < 0) return;
+
+            const char* data = blocks[write_block];
+            size_t size = write_size;
+            lock.unlock();
+            if(fwrite(data, 1, size, fp) != size)
+                fprintf(stderr, "Error writing trace.\n");
+            lock.lock();
+
+            write_block = -1;
+            cv.notify_all();
+        }
+    }
+
+    FILE* fp;
+    char* blocks[2];
+
+    // Block being filled by the simulation thread.
+    int fill_block;
+    size_t fill_size;
+
+    // Block being written by the writer thread, -1 if it is idle.
+    int write_block;
+    size_t write_size;
+
+    bool stop;
+    std::thread writer;
+    std::mutex mutex;
+    std::condition_variable cv;
+};